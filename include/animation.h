@@ -7,12 +7,20 @@
 class Animation
 {
 protected:
-    static std::shared_ptr<sf::Texture> playerTexture;  /**< The texture for the player animation. */
-    static std::shared_ptr<sf::Texture> repulseTexture; /**< The texture for the repulsive obstacle animation. */
-    static std::shared_ptr<sf::Texture> attractTexture; /**< The texture for the attractive obstacle animation. */
-    static bool isLoaded;              /**< Whether the textures have been loaded. */
+    static std::shared_ptr<sf::Texture> atlas; /**< The texture atlas holding the textures of every animation. */
+    static sf::IntRect playerRect;             /**< The area of the player texture in the atlas. */
+    static sf::IntRect repulseRect;            /**< The area of the repulsive obstacle texture in the atlas. */
+    static sf::IntRect attractRect;            /**< The area of the attractive obstacle texture in the atlas. */
+    static bool isLoaded;                      /**< Whether the textures have been loaded. */
 
-    std::shared_ptr<sf::Texture> texture; /**< The texture for this animation. */
+    sf::IntRect textureRect; /**< The area of the texture of this animation in the atlas. */
+
+    /**
+     * @brief Loads the textures and packs them side by side into the atlas.
+     *
+     * @throws std::runtime_error If a texture can't be loaded.
+     */
+    static void loadAtlas();
 
 public:
     enum class Type
@@ -39,7 +47,31 @@ public:
     /**
      * @brief Gets the texture for this animation.
      *
-     * @return The texture for this animation.
+     * @return The texture atlas, the area of this animation in it is given by getTextureRect().
+     */
+    const sf::Texture *getTexture() const { return atlas.get(); }
+
+    /**
+     * @brief Gets the area of the texture of this animation in the atlas.
+     *
+     * @return The area in pixels.
+     */
+    const sf::IntRect &getTextureRect() const { return textureRect; }
+
+    /**
+     * @brief Gets the texture atlas shared by every animation.
+     *
+     * Everything drawn with it can be drawn in one call, without switching textures.
+     *
+     * @return The atlas, null until the first animation has been constructed.
+     */
+    static const sf::Texture *getAtlas() { return atlas.get(); }
+
+    /**
+     * @brief Gets the area of the texture of a type of animation in the atlas.
+     *
+     * @param type The type of the animation.
+     * @return The area in pixels.
      */
-    const sf::Texture *getTexture() const { return texture.get(); }
+    static const sf::IntRect &getTypeTextureRect(const Type type);
 };
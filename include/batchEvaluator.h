@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+
+#include "physics.h"
+#include "simulationContext.h"
+#include "threadPool.h"
+
+/**
+ * @class BatchEvaluator
+ * @brief Simulates many independent players against the same level on every core.
+ *
+ * Every player has its own SimulationContext, the prepared physics engine (charge store, quadtree, field grid)
+ * is shared read-only between the threads. Used for exploring launch parameters of a level.
+ *
+ * Every thread advances groups of simulationLaneCount players in lockstep with PhysicsEngine::advanceLanes(),
+ * so the obstacles are streamed once per group and step instead of once per player and step.
+ */
+class BatchEvaluator
+{
+private:
+    ThreadPool pool; /**< The threads the players are split between. */
+
+public:
+    /**
+     * @brief Constructs an evaluator.
+     * @param threadCount The number of threads used, 0 means one per core.
+     */
+    explicit BatchEvaluator(const unsigned threadCount = 0) : pool(threadCount) {}
+
+    /**
+     * @brief Gets the number of threads used.
+     * @return The number of threads.
+     */
+    unsigned getThreadCount() const { return pool.getThreadCount(); }
+
+    /**
+     * @brief Simulates every context until its player hits an obstacle or the step limit is reached.
+     *
+     * The engine must have been prepared for the current charges and must not be changed during the call.
+     * Contexts which already hit an obstacle are left unchanged.
+     *
+     * @param engine The prepared physics engine.
+     * @param simulations The players to simulate, updated in place.
+     * @param timeStep The simulated time of a step in seconds.
+     * @param maxSteps The number of steps a context is simulated for at most, counted from zero.
+     */
+    void run(const PhysicsEngine &engine, std::vector<SimulationContext> &simulations, const float timeStep, const unsigned long maxSteps);
+};
@@ -0,0 +1,160 @@
+#pragma once
+#include <SFML\System.hpp>
+#include <vector>
+#include <cstddef>
+
+#include "chargeStore.h"
+#include "forceKernel.h"
+
+/**
+ * @class ChargeQuadtree
+ * @brief Barnes-Hut quadtree over the charges of a level.
+ *
+ * Every node stores the charge moments of the charges inside its square cell. Positive and negative
+ * charges are summed separately, so both have a well defined centre of charge even if the node contains
+ * a mix of attracting and repulsing charges. When the field is evaluated, nodes that look small enough from
+ * the evaluation point (cell size / distance < opening angle) are replaced by their two monopoles, so the
+ * cost of an evaluation is O(log N) instead of O(N).
+ *
+ * Obstacles don't move during play, so the tree only has to be built when the level is edited.
+ */
+class ChargeQuadtree
+{
+private:
+    /**
+     * @brief A square cell of the quadtree.
+     */
+    struct Node
+    {
+        float centerX;  /**< The x coordinate of the centre of the cell. */
+        float centerY;  /**< The y coordinate of the centre of the cell. */
+        float halfSize; /**< Half of the side length of the cell. */
+
+        float positiveCharge; /**< Sum of the positive charges in the cell. */
+        float positiveX;      /**< The x coordinate of the centre of positive charge. */
+        float positiveY;      /**< The y coordinate of the centre of positive charge. */
+        float negativeCharge; /**< Sum of the negative charges in the cell. */
+        float negativeX;      /**< The x coordinate of the centre of negative charge. */
+        float negativeY;      /**< The y coordinate of the centre of negative charge. */
+
+        int firstChild; /**< Index of the first of the four children in nodes, -1 for leaves. */
+        int bucket;     /**< Index of the bucket of the charges of a leaf, -1 for inner nodes. */
+    };
+
+    /**
+     * @brief The charges of a leaf, stored in the layout the force kernels expect.
+     */
+    struct Bucket
+    {
+        std::vector<float> x; /**< The x coordinates of the charges. */
+        std::vector<float> y; /**< The y coordinates of the charges. */
+        std::vector<float> q; /**< The electric charges of the charges. */
+    };
+
+    std::vector<Node> nodes;     /**< The nodes of the tree, the root is the first one. */
+    std::vector<Bucket> buckets; /**< The charges of the leaves. */
+
+    /**
+     * @brief Recursively builds the subtree of a node from the given charges.
+     * @param nodeIdx The index of the node to build.
+     * @param charges The charge store the tree is built from.
+     * @param indices The indices of the charges inside the cell of the node.
+     * @param depth The depth of the node.
+     */
+    void build(const size_t nodeIdx, const ChargeStore &charges, std::vector<size_t> &indices, const unsigned depth);
+
+    /**
+     * @brief Recalculates the charge moments of a node from its bucket or its children.
+     * @param nodeIdx The index of the node.
+     */
+    void updateMoments(const size_t nodeIdx);
+
+    /**
+     * @brief Splits a full leaf into four children, distributing its charges between them.
+     * @param nodeIdx The index of the leaf.
+     */
+    void split(const size_t nodeIdx);
+
+    /**
+     * @brief Finds the leaf containing the given position.
+     * @param posX The x coordinate of the position.
+     * @param posY The y coordinate of the position.
+     * @param path The indices of the nodes from the root to the leaf are appended to this vector.
+     * @return False if the position is outside of the root cell, true otherwise.
+     */
+    bool findLeaf(const float posX, const float posY, std::vector<size_t> &path) const;
+
+public:
+    /**
+     * @brief The maximum number of charges stored in a leaf before it is split.
+     */
+    static const size_t leafCapacity = 16;
+
+    /**
+     * @brief The maximum depth of the tree. Guards against endless splitting of coincident charges.
+     */
+    static const unsigned maxDepth = 24;
+
+    /**
+     * @brief Builds the tree from the given charges.
+     *
+     * The root cell is the smallest square containing both the charges and the given bounds.
+     *
+     * @param charges The charge store to build the tree from.
+     * @param bounds The size of the level, the root cell always covers it.
+     */
+    void build(const ChargeStore &charges, const sf::Vector2u &bounds);
+
+    /**
+     * @brief Removes every node from the tree.
+     */
+    void clear();
+
+    /**
+     * @brief Inserts a single charge into a built tree.
+     *
+     * Only the moments of the nodes on the path from the root to the leaf are updated, the leaf is split if it gets full.
+     *
+     * @param posX The x coordinate of the charge.
+     * @param posY The y coordinate of the charge.
+     * @param charge The electric charge of the charge.
+     * @return False if the charge is outside of the root cell and the tree has to be rebuilt, true otherwise.
+     */
+    bool insert(const float posX, const float posY, const float charge);
+
+    /**
+     * @brief Removes a single charge from a built tree.
+     *
+     * Only the moments of the nodes on the path from the root to the leaf are updated.
+     *
+     * @param posX The x coordinate of the charge.
+     * @param posY The y coordinate of the charge.
+     * @param charge The electric charge of the charge.
+     * @return False if the charge is not in the tree and the tree has to be rebuilt, true otherwise.
+     */
+    bool remove(const float posX, const float posY, const float charge);
+
+    /**
+     * @brief Checks whether the tree has been built.
+     * @return True if the tree has nodes, false otherwise.
+     */
+    bool isBuilt() const { return !nodes.empty(); }
+
+    /**
+     * @brief Approximates the summed electric field of the charges at the given position.
+     *
+     * Calculates the same sum as sumElectricField(): sum(q_i * (ri / abs(ri)^3)).
+     *
+     * @param pos The position the field is evaluated at.
+     * @param openingAngle The opening angle (theta). 0 gives the exact sum, larger values are faster and less accurate.
+     * @param kernel The kernel the charges of opened leaves are summed with.
+     * @return The approximated field as a 2D vector.
+     */
+    sf::Vector2f evaluate(const sf::Vector2f &pos, const float openingAngle, const ForceKernel kernel) const;
+
+    /**
+     * @brief Gets the number of nodes in the tree.
+     * @return The number of nodes.
+     */
+    size_t getNodeCount() const { return nodes.size(); }
+};
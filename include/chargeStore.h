@@ -0,0 +1,229 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <atomic>
+
+/**
+ * @brief A single edit of the charges of a level.
+ *
+ * Data structures derived from the charges (field grid, quadtree, ...) can apply the edits one by one
+ * instead of being rebuilt from every charge.
+ */
+struct ChargeDelta
+{
+    /**
+     * @brief The kinds of edits.
+     */
+    enum class Type
+    {
+        Add,   /**< The charge has been added. */
+        Remove,    /**< The charge has been removed, the charges after it moved down by one. */
+        SwapRemove /**< The charge has been removed, the last charge moved to its index. */
+    };
+
+    Type type;             /**< The kind of the edit. */
+    float x;               /**< The x coordinate of the charge. */
+    float y;               /**< The y coordinate of the charge. */
+    float q;               /**< The electric charge of the charge. */
+    float collisionRadius; /**< The collision radius of the charge. */
+    size_t index;          /**< The index of the charge in the store when the edit was made. */
+    unsigned long revision; /**< The revision of the level after the edit. */
+};
+
+/**
+ * @class ChargeStore
+ * @brief Stores the physical data of the obstacles of a level in a structure-of-arrays layout.
+ *
+ * Every obstacle has its x and y coordinates, its electric charge and its collision radius stored
+ * in separate contiguous arrays under the same index. The physics simulation streams through these
+ * arrays instead of dereferencing every obstacle and its body through shared pointers.
+ *
+ * The store doesn't depend on the graphical representation of the obstacles, so the physics can run
+ * on it without a window. The arrays can also be viewed in memory the store doesn't own (a mapped binary
+ * level file), they are only copied when the store is edited. Every edit changes the revision of the store and is recorded in a bounded
+ * log, so data derived from the charges can be updated incrementally.
+ */
+class ChargeStore
+{
+private:
+    std::vector<float> x;               /**< The x coordinates of the charges. */
+    std::vector<float> y;               /**< The y coordinates of the charges. */
+    std::vector<float> q;               /**< The electric charges of the charges. */
+    std::vector<float> collisionRadius; /**< The collision radii of the charges. */
+
+    std::shared_ptr<const void> external; /**< Keeps the viewed arrays alive, null if the store owns its arrays. */
+    const float *viewX;               /**< The x coordinates, points into the owned or the viewed arrays. */
+    const float *viewY;               /**< The y coordinates, points into the owned or the viewed arrays. */
+    const float *viewQ;               /**< The electric charges, points into the owned or the viewed arrays. */
+    const float *viewCollisionRadius; /**< The collision radii, points into the owned or the viewed arrays. */
+    size_t count;                     /**< The number of charges. */
+
+    unsigned long revision; /**< Changes every time the charges change. */
+    static std::atomic<unsigned long> revisionCounter; /**< Source of revisions, unique across every store instance, stores are also edited by loading threads. */
+
+    std::vector<ChargeDelta> deltas; /**< The latest edits of the charges, oldest first. */
+    unsigned long deltaBaseRevision; /**< The revision of the store before the first edit in deltas. */
+
+    /**
+     * @brief Bumps the revision and records the edit in the delta log.
+     * @param type The kind of the edit.
+     * @param idx The index of the edited charge.
+     */
+    void recordDelta(const ChargeDelta::Type type, const size_t idx);
+
+    /**
+     * @brief Points the views to the owned arrays after they have been changed.
+     */
+    void updateViews();
+
+public:
+    /**
+     * @brief Constructs an empty store with a new revision.
+     */
+    ChargeStore();
+
+    /**
+     * @brief Copies a store, viewed arrays are shared instead of copied.
+     * @param other The store to copy.
+     */
+    ChargeStore(const ChargeStore &other);
+
+    /**
+     * @brief Copies a store, viewed arrays are shared instead of copied.
+     * @param other The store to copy.
+     * @return This store.
+     */
+    ChargeStore &operator=(const ChargeStore &other);
+
+    /**
+     * @brief Moves a store without copying its arrays, the other store is left empty.
+     * @param other The store to move.
+     */
+    ChargeStore(ChargeStore &&other) noexcept;
+
+    /**
+     * @brief Moves a store without copying its arrays, the other store is left empty.
+     * @param other The store to move.
+     * @return This store.
+     */
+    ChargeStore &operator=(ChargeStore &&other) noexcept;
+
+    /**
+     * @brief Makes the store use arrays it doesn't own instead of copying them (for example a memory mapped level file).
+     *
+     * The arrays are only read, the first edit of the store copies them. Like clear(), this drops the delta log.
+     *
+     * @param owner Keeps the arrays alive while the store (or a copy of it) uses them.
+     * @param chargeCount The number of charges in the arrays.
+     * @param posX The x coordinates of the charges.
+     * @param posY The y coordinates of the charges.
+     * @param charge The electric charges of the charges.
+     * @param radius The collision radii of the charges.
+     */
+    void view(const std::shared_ptr<const void> &owner, const size_t chargeCount,
+              const float *posX, const float *posY, const float *charge, const float *radius);
+
+    /**
+     * @brief Copies the viewed arrays into the owned ones, so they can be edited and the viewed memory can be released.
+     *
+     * Does nothing if the store owns its arrays. The revision and the delta log don't change.
+     */
+    void detach();
+
+    /**
+     * @brief Checks whether the store uses arrays it doesn't own.
+     * @return True if the arrays are viewed, false if they are owned.
+     */
+    bool isView() const { return external != nullptr; }
+
+    /**
+     * @brief Adds a charge to the end of the store.
+     * @param posX The x coordinate of the charge.
+     * @param posY The y coordinate of the charge.
+     * @param charge The electric charge of the charge.
+     * @param radius The collision radius of the charge.
+     */
+    void add(const float posX, const float posY, const float charge, const float radius);
+
+    /**
+     * @brief Removes a charge from the store, keeping the order of the remaining charges.
+     * @param idx The index of the charge to remove.
+     */
+    void remove(const size_t idx);
+
+    /**
+     * @brief Removes a charge from the store by moving the last charge into its place.
+     *
+     * Only the last charge changes its index, so batches of removals cost O(1) each instead of O(N).
+     *
+     * @param idx The index of the charge to remove.
+     */
+    void swapRemove(const size_t idx);
+
+    /**
+     * @brief Removes every charge from the store.
+     *
+     * Clearing can't be described by a few edits, so the delta log is dropped as well.
+     */
+    void clear();
+
+    /**
+     * @brief Reserves memory for the given number of charges.
+     * @param reserved The number of charges to reserve memory for.
+     */
+    void reserve(const size_t reserved);
+
+    /**
+     * @brief Gets the number of charges in the store.
+     * @return The number of charges.
+     */
+    size_t size() const { return count; }
+
+    /**
+     * @brief Gets the x coordinates of the charges.
+     * @return Pointer to the first element of the contiguous x coordinate array.
+     */
+    const float *getX() const { return viewX; }
+
+    /**
+     * @brief Gets the y coordinates of the charges.
+     * @return Pointer to the first element of the contiguous y coordinate array.
+     */
+    const float *getY() const { return viewY; }
+
+    /**
+     * @brief Gets the electric charges of the charges.
+     * @return Pointer to the first element of the contiguous charge array.
+     */
+    const float *getCharge() const { return viewQ; }
+
+    /**
+     * @brief Gets the collision radii of the charges.
+     * @return Pointer to the first element of the contiguous collision radius array.
+     */
+    const float *getCollisionRadius() const { return viewCollisionRadius; }
+
+    /**
+     * @brief Gets the revision of the charges.
+     *
+     * The revision is unique across every store instance and changes whenever a charge is added or removed,
+     * so cached data derived from the charges can be invalidated by comparing it.
+     *
+     * @return The revision of the charges.
+     */
+    unsigned long getRevision() const { return revision; }
+
+    /**
+     * @brief Gets the edits of the charges made since the given revision.
+     *
+     * Only the latest edits are kept (see maxChargeDeltas in settings.h). If the log doesn't reach back
+     * to the given revision (or the store has been replaced or cleared since), the caller has to rebuild
+     * its data from the arrays instead.
+     *
+     * @param sinceRevision The revision the caller is up to date with.
+     * @param result The edits made since the revision are appended to this vector, oldest first.
+     * @return True if the edits could be collected, false if the caller has to rebuild.
+     */
+    bool getDeltasSince(const unsigned long sinceRevision, std::vector<ChargeDelta> &result) const;
+};
@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+/**
+ * @brief Compresses bytes with a small LZ77 codec built for fast decompression.
+ *
+ * The output is a sequence of blocks, each made of a run of literal bytes and a copy of earlier output
+ * (2 byte offset, at least 4 bytes long). Repeated patterns, like the delta coded positions of a painted
+ * stroke of charges, shrink to a few bytes per repetition. Decompressing only copies bytes.
+ *
+ * @param data The bytes to compress.
+ * @param size The number of bytes.
+ * @return The compressed bytes. Incompressible input grows by less than 1%.
+ */
+std::vector<unsigned char> compressBytes(const unsigned char *data, const size_t size);
+
+/**
+ * @brief Decompresses the output of compressBytes().
+ * @param compressed The compressed bytes.
+ * @param compressedSize The number of compressed bytes.
+ * @param output Receives the decompressed bytes, must hold size bytes.
+ * @param size The size of the decompressed data.
+ * @throws std::runtime_error If the compressed bytes are corrupt or don't decompress to exactly size bytes.
+ */
+void decompressBytes(const unsigned char *compressed, const size_t compressedSize, unsigned char *output, const size_t size);
@@ -0,0 +1,105 @@
+#pragma once
+#include <SFML\System.hpp>
+#include <vector>
+#include <cstddef>
+
+#include "chargeStore.h"
+#include "forceKernel.h"
+
+/**
+ * @class FieldGrid
+ * @brief Precomputed electric field of the obstacles on a regular grid.
+ *
+ * Obstacles don't move during play, so the field the player feels is a fixed function of its position.
+ * The grid stores the summed field of every charge at its nodes, so evaluating the field during play is a
+ * single interpolated lookup, independent of the number of charges.
+ *
+ * Nodes lying exactly on a charge store zero instead of an infinite field. The player collides with the charge
+ * before it could get there anyway.
+ */
+class FieldGrid
+{
+public:
+    /**
+     * @brief The interpolation methods used between the nodes of the grid.
+     */
+    enum class Interpolation
+    {
+        Bilinear, /**< Interpolates between the 4 surrounding nodes. */
+        Bicubic   /**< Catmull-Rom interpolation between the 16 surrounding nodes, smooth first derivatives. */
+    };
+
+private:
+    float cellSize;           /**< The distance between two neighbouring nodes in pixels. */
+    unsigned columns;         /**< The number of nodes in a row. */
+    unsigned rows;            /**< The number of nodes in a column. */
+    std::vector<float> fieldX; /**< The x component of the field at each node, row by row. */
+    std::vector<float> fieldY; /**< The y component of the field at each node, row by row. */
+
+    /**
+     * @brief Gets the index of the node in the given column and row, clamped to the grid.
+     * @param column The column of the node.
+     * @param row The row of the node.
+     * @return The index of the node in fieldX and fieldY.
+     */
+    size_t getNodeIndex(int column, int row) const;
+
+public:
+    /**
+     * @brief Constructs an empty grid.
+     */
+    FieldGrid();
+
+    /**
+     * @brief Calculates the field at every node of a grid covering the level.
+     *
+     * The rows of the grid are split between the given number of threads.
+     *
+     * @param charges The charges to calculate the field of.
+     * @param size The size of the level the grid covers.
+     * @param newCellSize The distance between two neighbouring nodes in pixels.
+     * @param kernel The kernel the field of the charges is summed with.
+     * @param threadCount The number of threads used for the calculation.
+     */
+    void bake(const ChargeStore &charges, const sf::Vector2u &size, const float newCellSize, const ForceKernel kernel, const unsigned threadCount);
+
+    /**
+     * @brief Adds the field of a single charge to every node.
+     *
+     * Used to update the grid when a charge is placed in the editor without recalculating every other charge.
+     * Removing a charge is adding the same charge with opposite sign.
+     *
+     * @param posX The x coordinate of the charge.
+     * @param posY The y coordinate of the charge.
+     * @param charge The electric charge of the charge.
+     */
+    void addCharge(const float posX, const float posY, const float charge);
+
+    /**
+     * @brief Interpolates the field at the given position.
+     *
+     * Positions outside of the grid are clamped to its edge.
+     *
+     * @param pos The position the field is evaluated at.
+     * @param interpolation The interpolation method.
+     * @return The interpolated field, same as sumElectricField() would return.
+     */
+    sf::Vector2f sample(const sf::Vector2f &pos, const Interpolation interpolation) const;
+
+    /**
+     * @brief Removes every node from the grid.
+     */
+    void clear();
+
+    /**
+     * @brief Checks whether the grid contains data.
+     * @return True if the grid has been baked, false otherwise.
+     */
+    bool isBaked() const { return !fieldX.empty(); }
+
+    /**
+     * @brief Gets the number of nodes of the grid.
+     * @return The number of nodes.
+     */
+    size_t getNodeCount() const { return fieldX.size(); }
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <SFML\Graphics.hpp>
+#include <vector>
+#include <memory>
+#include <future>
+#include <cstddef>
+
+#include "chargeStore.h"
+#include "forceKernel.h"
+#include "threadPool.h"
+
+/**
+ * @class FieldLineTracer
+ * @brief Traces the field lines of the charges of a level in the background and draws them.
+ *
+ * Lines are seeded around the charges and followed along the electric field with an adaptive Runge-Kutta method
+ * (Bogacki-Shampine 3(2)), the field is summed with the same force kernel the physics engine uses. Lines start
+ * from positive charges along the field and from negative charges against it, so every charge gets lines.
+ *
+ * The lines are traced on a thread pool in a background job started when the charges or the size of the level change.
+ * Until it is done, the lines of the previous version of the level are drawn, the finished lines are cached in a
+ * single vertex array. fieldLineMaxLines and fieldLineMaxPoints bound the work of a job on huge levels.
+ */
+class FieldLineTracer : public sf::Drawable
+{
+private:
+    ForceKernel kernel;               /**< The instruction set the field is summed with. */
+    std::unique_ptr<ThreadPool> pool; /**< The threads the lines are split between, started by the first update. */
+
+    sf::VertexArray lines; /**< The segments of the traced lines. */
+
+    std::future<sf::VertexArray> job; /**< The running trace, invalid if none is running. */
+    unsigned long jobRevision;        /**< The revision of the charges the running trace was started with. */
+    sf::Vector2u jobSize;             /**< The size of the level the running trace was started with. */
+    unsigned long tracedRevision;     /**< The revision of the charges the lines belong to, 0 if none. */
+    sf::Vector2u tracedSize;          /**< The size of the level the lines belong to. */
+
+    /**
+     * @brief Traces the lines of the given charges.
+     * @param charges The charges of the level.
+     * @param size The size of the level, lines end at its edges.
+     * @return The segments of the lines.
+     */
+    sf::VertexArray trace(const ChargeStore &charges, const sf::Vector2u &size) const;
+
+    /**
+     * @brief Follows a single field line from its seed.
+     * @param charges The charges of the level.
+     * @param size The size of the level.
+     * @param start The first point of the line.
+     * @param direction 1 to follow the field, -1 to go against it.
+     * @param points The points of the line are appended here.
+     */
+    void traceLine(const ChargeStore &charges, const sf::Vector2u &size, const sf::Vector2f &start, const float direction, std::vector<sf::Vector2f> &points) const;
+
+    /**
+     * @brief Draws the cached lines.
+     * @param target The target to draw to.
+     * @param states The render states.
+     */
+    void draw(sf::RenderTarget &target, sf::RenderStates states) const override;
+
+public:
+    /**
+     * @brief Constructs a tracer without lines.
+     */
+    FieldLineTracer();
+
+    /**
+     * @brief Waits for the running trace.
+     */
+    ~FieldLineTracer();
+
+    FieldLineTracer(const FieldLineTracer &) = delete;
+    FieldLineTracer &operator=(const FieldLineTracer &) = delete;
+
+    /**
+     * @brief Takes the lines of a finished trace and starts a new one if the level changed since the lines were traced.
+     *
+     * Doesn't wait for the trace, the charges are copied for it.
+     *
+     * @param charges The charges of the level.
+     * @param size The size of the level.
+     */
+    void update(const ChargeStore &charges, const sf::Vector2u &size);
+
+    /**
+     * @brief Waits for the running trace and takes its lines.
+     */
+    void wait();
+};
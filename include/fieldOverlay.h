@@ -0,0 +1,102 @@
+#pragma once
+#include <SFML\Graphics.hpp>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+#include "chargeStore.h"
+#include "forceKernel.h"
+#include "threadPool.h"
+
+/**
+ * @class FieldOverlay
+ * @brief Shows the electric potential and field strength of the charges of a level over the whole level.
+ *
+ * The potential and field are sampled on a grid of fieldOverlayCellSize pixels with the vectorized force kernels.
+ * The grid is split into tiles of fieldOverlayTileSize samples which are calculated in parallel on a thread pool.
+ * Positive potential is red, negative potential blue and the field strength green, on fixed scales, so a color only
+ * changes where the field changes.
+ *
+ * When charges are edited, only the field of the edited charges is added to (or subtracted from) the stored samples,
+ * instead of summing every charge again, and only the tiles whose colors changed are uploaded to the texture.
+ * After fieldOverlayRefreshEdits edits every charge is summed again, so rounding errors can't accumulate.
+ */
+class FieldOverlay : public sf::Drawable
+{
+private:
+    std::unique_ptr<ThreadPool> pool; /**< The threads the tiles are split between, started by the first update. */
+    ForceKernel kernel;               /**< The instruction set the samples are summed with. */
+
+    unsigned columns;              /**< The number of samples in a row. */
+    unsigned rows;                 /**< The number of samples in a column. */
+    unsigned tileColumns;          /**< The number of tiles in a row. */
+    unsigned tileRows;             /**< The number of tiles in a column. */
+    std::vector<float> fieldX;     /**< The x component of the field at each sample, row by row. */
+    std::vector<float> fieldY;     /**< The y component of the field at each sample, row by row. */
+    std::vector<float> potential;  /**< The potential at each sample, row by row. */
+    std::vector<uint8_t> pixels;   /**< The RGBA color of each sample, row by row. */
+    std::vector<char> isTileDirty; /**< Whether the colors of a tile changed since they were uploaded. */
+
+    sf::Texture texture; /**< Holds a texel per sample. */
+    sf::Sprite sprite;   /**< Stretches the texture over the level. */
+
+    unsigned long preparedRevision; /**< The revision of the charges the samples were calculated from, 0 if none. */
+    sf::Vector2u preparedSize;      /**< The size of the level the grid covers. */
+    size_t incrementalEdits;        /**< The number of edits added to the samples since every charge was summed. */
+
+    /**
+     * @brief Adds the field and potential of the given charges to the samples of a tile and colors it again.
+     * @param tile The index of the tile, row by row.
+     * @param x The x coordinates of the charges.
+     * @param y The y coordinates of the charges.
+     * @param q The electric charges of the charges.
+     * @param count The number of charges.
+     * @param isReset Whether the samples are overwritten instead of added to.
+     */
+    void accumulateTile(const size_t tile, const float *x, const float *y, const float *q, const size_t count, const bool isReset);
+
+    /**
+     * @brief Resizes the grid and the texture to cover a level, every sample is cleared.
+     * @param size The size of the level.
+     */
+    void resize(const sf::Vector2u &size);
+
+    /**
+     * @brief Uploads the dirty tiles to the texture.
+     */
+    void upload();
+
+    /**
+     * @brief Draws the texture stretched over the level.
+     * @param target The target to draw to.
+     * @param states The render states.
+     */
+    void draw(sf::RenderTarget &target, sf::RenderStates states) const override;
+
+public:
+    /**
+     * @brief Constructs an empty overlay, the threads are only started by the first update.
+     */
+    FieldOverlay();
+
+    /**
+     * @brief Brings the overlay up to date with the charges of a level.
+     *
+     * Does nothing if the charges and the size didn't change. Edits found in the delta log of the store are applied
+     * incrementally, otherwise (or once fieldOverlayRefreshEdits edits have been applied) every sample is calculated again.
+     *
+     * @param charges The charges of the level.
+     * @param size The size of the level.
+     */
+    void update(const ChargeStore &charges, const sf::Vector2u &size);
+
+    /**
+     * @brief Gets the color of a sample.
+     * @param samplePotential The potential at the sample.
+     * @param sampleFieldX The x component of the field at the sample.
+     * @param sampleFieldY The y component of the field at the sample.
+     * @param color The RGBA color is written here.
+     */
+    static void colorSample(const float samplePotential, const float sampleFieldX, const float sampleFieldY, uint8_t *color);
+};
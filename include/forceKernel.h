@@ -0,0 +1,108 @@
+#pragma once
+#include <SFML\System.hpp>
+#include <cstddef>
+
+/**
+ * @brief The instruction sets the electric field summation can be run with.
+ */
+enum class ForceKernel
+{
+    Scalar, /**< Plain C++ loop, reference implementation. */
+    SSE4,   /**< 4 charges per iteration. */
+    AVX2    /**< 8 charges per iteration. */
+};
+
+/**
+ * @brief Detects the widest force kernel the CPU running the program supports.
+ *
+ * The detection is only done on the first call, later calls return the cached result.
+ *
+ * @return The best supported force kernel.
+ */
+ForceKernel detectForceKernel();
+
+/**
+ * @brief Gets the name of a force kernel.
+ * @param kernel The force kernel.
+ * @return The name of the kernel, for debug printing.
+ */
+const char *getForceKernelName(const ForceKernel kernel);
+
+/**
+ * @brief Sums the electric field of the given charges at the given position.
+ *
+ * Calculates sum(q_i * (ri / abs(ri)^3)) where ri is the vector pointing from the position to charge i
+ * (the convention PhysicsEngine uses). The result still has to be multiplied by the Coulomb constant and
+ * the charge the field acts on to get the force.
+ *
+ * @param x The x coordinates of the charges.
+ * @param y The y coordinates of the charges.
+ * @param q The electric charges of the charges.
+ * @param count The number of charges.
+ * @param pos The position the field is evaluated at.
+ * @param kernel The kernel to run the summation with. Must be supported by the CPU.
+ * @return The summed field as a 2D vector.
+ */
+sf::Vector2f sumElectricField(const float *x, const float *y, const float *q, const size_t count, const sf::Vector2f &pos, const ForceKernel kernel);
+
+/**
+ * @brief Scalar reference implementation of sumElectricField().
+ *
+ * Every vectorized kernel must give the same result as this function up to floating point rounding.
+ */
+sf::Vector2f sumElectricFieldScalar(const float *x, const float *y, const float *q, const size_t count, const sf::Vector2f &pos);
+
+/**
+ * @brief Gets the number of positions the lane kernels of a force kernel evaluate at once.
+ * @param kernel The force kernel.
+ * @return 8 for AVX2, 4 for SSE4 and 1 for the scalar kernel.
+ */
+size_t getForceKernelLaneCount(const ForceKernel kernel);
+
+/**
+ * @brief Sums the electric field of the given charges at several positions at once.
+ *
+ * The positions are processed in tiles of getForceKernelLaneCount() lanes: every charge is loaded once per tile
+ * and its field is evaluated at every position of the tile, so the charge arrays are streamed
+ * laneCount / getForceKernelLaneCount() times instead of laneCount times.
+ *
+ * The field at a position doesn't depend on the other positions of the call, partially filled tiles are padded.
+ * Gives the same result as sumElectricFieldScalar() up to floating point rounding.
+ *
+ * @param x The x coordinates of the charges.
+ * @param y The y coordinates of the charges.
+ * @param q The electric charges of the charges.
+ * @param count The number of charges.
+ * @param posX The x coordinates of the positions the field is evaluated at.
+ * @param posY The y coordinates of the positions the field is evaluated at.
+ * @param laneCount The number of positions.
+ * @param fieldX The x components of the summed fields are written here, one per position.
+ * @param fieldY The y components of the summed fields are written here, one per position.
+ * @param kernel The kernel to run the summation with. Must be supported by the CPU.
+ */
+void sumElectricFieldLanes(const float *x, const float *y, const float *q, const size_t count,
+                           const float *posX, const float *posY, const size_t laneCount,
+                           float *fieldX, float *fieldY, const ForceKernel kernel);
+
+/**
+ * @brief Sums the electric field and the electric potential of the given charges at several positions at once.
+ *
+ * Used for visualizing the field, not by the physics. The squared distances are softened by a constant, so positions
+ * on top of a charge get a large but finite value. The positions are processed in tiles like in sumElectricFieldLanes().
+ *
+ * @param x The x coordinates of the charges.
+ * @param y The y coordinates of the charges.
+ * @param q The electric charges of the charges.
+ * @param count The number of charges.
+ * @param posX The x coordinates of the positions.
+ * @param posY The y coordinates of the positions.
+ * @param laneCount The number of positions.
+ * @param softening Added to every squared distance, in pixels squared.
+ * @param fieldX The x components of the summed fields are written here, one per position.
+ * @param fieldY The y components of the summed fields are written here, one per position.
+ * @param potential The summed potentials (sum(q_i / abs(ri))) are written here, one per position.
+ * @param kernel The kernel to run the summation with. Must be supported by the CPU.
+ */
+void sumFieldAndPotentialLanes(const float *x, const float *y, const float *q, const size_t count,
+                               const float *posX, const float *posY, const size_t laneCount, const float softening,
+                               float *fieldX, float *fieldY, float *potential, const ForceKernel kernel);
@@ -5,6 +5,9 @@
 #include <memory>
 
 #include "obstacle.h"
+#include "chargeStore.h"
+#include "spatialHash.h"
+#include "levelData.h"
 #include "settings.h"
 
 extern const unsigned windowWidth;
@@ -20,6 +23,8 @@ private:
     std::string name; /**< The name of the level. */
     sf::Vector2u size; /**< The size of the level. */
     std::vector<std::shared_ptr<Obstacle>> obstacles; /**< The obstacles in the level. */
+    ChargeStore charges; /**< The physical data of the obstacles, stored under the same indices as obstacles. */
+    SpatialHash obstacleHash; /**< The bodies of the obstacles, for finding them by position. */
     sf::Vector2f playerStartPos; /**< The starting position of the player in the level. */
 
 public:
@@ -32,6 +37,18 @@ public:
      */
     Level(const std::string &levelName = "empty_level", const sf::Vector2u &levelSize = sf::Vector2u(windowWidth, windowHeight), const std::vector<std::shared_ptr<Obstacle>> &obstacles = std::vector<std::shared_ptr<Obstacle>>(), const sf::Vector2f &playerStartPos = sf::Vector2f(windowWidth / 2, windowHeight / 2));
 
+    /**
+     * @brief Constructs a Level object from loaded level data, creating an obstacle for every charge.
+     * @param data The name, size, player start position and charges of the level.
+     */
+    explicit Level(const LevelData &data);
+
+    /**
+     * @brief Copies the physical contents of the level.
+     * @return The name, size, player start position and charges of the level.
+     */
+    LevelData getData() const { return LevelData{name, size, playerStartPos, charges}; }
+
     /**
      * @brief Adds an obstacle to the level.
      * @param newObstacle The obstacle to add.
@@ -44,6 +61,22 @@ public:
      */
     const std::vector<std::shared_ptr<Obstacle>> &getObstacles() const { return obstacles; }
 
+    /**
+     * @brief Gets the physical data of the obstacles in the level.
+     *
+     * The revision and the edit log of the store can be used to keep data derived from the obstacles up to date.
+     *
+     * @return The charge store of the level, indexed the same way as the obstacles.
+     */
+    const ChargeStore &getCharges() const { return charges; }
+
+    /**
+     * @brief Copies the charges out of the mapped level file they were loaded from, if any.
+     *
+     * On Windows a file can't be replaced or deleted while it is mapped, so this is done before the level is saved.
+     */
+    void releaseLevelFile() { charges.detach(); }
+
     /**
      * @brief Gets the starting position of the player in the level.
      * @return The starting position of the player.
@@ -84,11 +117,25 @@ public:
     /**
      * @brief Clears all obstacles from the level.
      */
-    void clearObstacles() { obstacles.clear(); }
+    void clearObstacles();
 
     /**
-     * @brief Removes an obstacle from the level.
+     * @brief Removes an obstacle from the level, the last obstacle is moved to its index.
      * @param idx The index of the obstacle to remove.
      */
-    void removeObstacle(size_t idx) { obstacles.erase(obstacles.begin() + idx); }
+    void removeObstacle(size_t idx);
+
+    /**
+     * @brief Removes several obstacles from the level, each in O(1).
+     * @param indices The indices of the obstacles to remove, duplicates are ignored. The vector is sorted.
+     */
+    void removeObstacles(std::vector<size_t> &indices);
+
+    /**
+     * @brief Finds the obstacles whose body reaches into a disc.
+     * @param center The center of the disc.
+     * @param radius The radius of the disc, 0 finds the obstacles containing the center.
+     * @param result The indices of the obstacles are appended to this vector, in no particular order.
+     */
+    void findObstacles(const sf::Vector2f &center, const float radius, std::vector<size_t> &result) const { obstacleHash.queryRadius(center, radius, result); }
 };
\ No newline at end of file
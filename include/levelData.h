@@ -0,0 +1,19 @@
+#pragma once
+#include <SFML\System.hpp>
+#include <string>
+
+#include "chargeStore.h"
+
+/**
+ * @brief The contents of a level file without any graphical representation.
+ *
+ * Loading a level into this struct doesn't create obstacles, shapes or textures, so it can be used
+ * without a window (headless simulation, batch validation of levels). A Level can be constructed from it.
+ */
+struct LevelData
+{
+    std::string name;            /**< The name of the level. */
+    sf::Vector2u size;           /**< The size of the level. */
+    sf::Vector2f playerStartPos; /**< The starting position of the player in the level. */
+    ChargeStore charges;         /**< The position, charge and collision radius of every obstacle. */
+};
@@ -0,0 +1,184 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief The file formats a level can be saved in.
+ */
+enum class LevelFormat
+{
+    Json,      /**< Human readable JSON, levels/<name>.json. */
+    Binary,    /**< Packed arrays which can be memory mapped, levels/<name>.lvl. */
+    Compressed /**< Delta coded, palette coded and compressed obstacles, levels/<name>.clvl. */
+};
+
+/**
+ * @brief The header at the start of a binary level file.
+ *
+ * The header is followed by the name of the level (nameLength bytes, not terminated), then by the x coordinate,
+ * y coordinate, electric charge and collision radius arrays of the obstacles, each at the given offset from the
+ * start of the file. Every array holds obstacleCount little-endian 32 bit floats and starts at a multiple of
+ * binaryLevelAlignment, so a mapped file can be used by the charge store without copying.
+ */
+struct BinaryLevelHeader
+{
+    char magic[4];          /**< Always binaryLevelMagic. */
+    uint32_t version;       /**< The version of the format, binaryLevelVersion when written. */
+    uint32_t headerSize;    /**< The size of the header in bytes, the name starts right after it. */
+    uint32_t nameLength;    /**< The length of the name of the level in bytes. */
+    uint32_t sizeX;         /**< The width of the level. */
+    uint32_t sizeY;         /**< The height of the level. */
+    float playerStartX;     /**< The x coordinate of the starting position of the player. */
+    float playerStartY;     /**< The y coordinate of the starting position of the player. */
+    uint64_t obstacleCount; /**< The number of obstacles. */
+    uint64_t xOffset;       /**< Offset of the x coordinate array. */
+    uint64_t yOffset;       /**< Offset of the y coordinate array. */
+    uint64_t chargeOffset;  /**< Offset of the electric charge array. */
+    uint64_t radiusOffset;  /**< Offset of the collision radius array. */
+};
+
+static_assert(sizeof(BinaryLevelHeader) == 72, "BinaryLevelHeader must not contain padding");
+
+/**
+ * @brief The first 4 bytes of every binary level file.
+ */
+const char binaryLevelMagic[4] = {'C', 'H', 'G', 'L'};
+
+/**
+ * @brief The version of the binary level format written by this program.
+ */
+const uint32_t binaryLevelVersion = 1;
+
+/**
+ * @brief The alignment of the arrays in a binary level file in bytes, a cache line.
+ */
+const size_t binaryLevelAlignment = 64;
+
+/**
+ * @brief The header at the start of a compressed level file.
+ *
+ * The header is followed by the name of the level (nameLength bytes, not terminated), then by compressedSize bytes
+ * of compressBytes() output (see compression.h) which decompress to payloadSize bytes. The payload holds:
+ * - the palette, paletteSize pairs of little-endian 32 bit floats (electric charge, collision radius),
+ * - the palette index of every obstacle, as runs: an index followed by the number of obstacles using it,
+ * - the position of every obstacle, x then y, as the difference to the previous obstacle (the first one to 0) in
+ *   units of 1 / positionScale pixel.
+ * Indices, run lengths and differences are LEB128 varints, differences are zigzag coded first. Painted strokes have
+ * runs of identical charges and small, repeating differences, which the codec shrinks further.
+ */
+struct CompressedLevelHeader
+{
+    char magic[4];          /**< Always compressedLevelMagic. */
+    uint32_t version;       /**< The version of the format, compressedLevelVersion when written. */
+    uint32_t headerSize;    /**< The size of the header in bytes, the name starts right after it. */
+    uint32_t nameLength;    /**< The length of the name of the level in bytes. */
+    uint32_t sizeX;         /**< The width of the level. */
+    uint32_t sizeY;         /**< The height of the level. */
+    float playerStartX;     /**< The x coordinate of the starting position of the player. */
+    float playerStartY;     /**< The y coordinate of the starting position of the player. */
+    uint64_t obstacleCount; /**< The number of obstacles. */
+    uint32_t paletteSize;   /**< The number of distinct (charge, radius) pairs. */
+    uint32_t positionScale; /**< Positions are rounded to 1 / positionScale pixel. */
+    uint64_t payloadSize;   /**< The size of the decompressed payload in bytes. */
+    uint64_t compressedSize; /**< The size of the compressed payload in bytes. */
+};
+
+static_assert(sizeof(CompressedLevelHeader) == 64, "CompressedLevelHeader must not contain padding");
+
+/**
+ * @brief The first 4 bytes of every compressed level file.
+ */
+const char compressedLevelMagic[4] = {'C', 'H', 'G', 'C'};
+
+/**
+ * @brief The version of the compressed level format written by this program.
+ */
+const uint32_t compressedLevelVersion = 1;
+
+/**
+ * @brief The positions of a compressed level are rounded to 1 / compressedPositionScale pixel.
+ *
+ * Positions placed with the mouse are whole pixels, they are stored exactly.
+ */
+const uint32_t compressedPositionScale = 256;
+
+/**
+ * @brief The header at the start of a level journal, levels/<name>.journal.
+ *
+ * A journal holds the edits saved since the level file was last written in full. It is only applied on
+ * top of the level file whose checksum is in the header, so a journal left over from an older level file
+ * is ignored. The header is followed by LevelJournalRecords.
+ */
+struct LevelJournalHeader
+{
+    char magic[4];         /**< Always levelJournalMagic. */
+    uint32_t version;      /**< The version of the format, levelJournalVersion when written. */
+    uint64_t baseChecksum; /**< The checksum of the level file the edits apply to (see LevelInfo). */
+};
+
+static_assert(sizeof(LevelJournalHeader) == 16, "LevelJournalHeader must not contain padding");
+
+/**
+ * @brief The kinds of records in a level journal.
+ */
+enum class LevelJournalRecordType : uint32_t
+{
+    AddCharge,       /**< A charge was added to the end, values are x, y, charge and collision radius. */
+    RemoveCharge,    /**< The charge at index was removed. */
+    Level,           /**< The level was saved, values are its width, height and the starting position of the player. */
+    SwapRemoveCharge /**< The charge at index was removed and the last charge moved to its index. */
+};
+
+/**
+ * @brief A single record of a level journal.
+ *
+ * Records are only ever appended. A record whose check doesn't match was torn by a crash while being
+ * written, it and everything after it are ignored.
+ */
+struct LevelJournalRecord
+{
+    LevelJournalRecordType type; /**< The kind of the record. */
+    uint32_t index;              /**< The index of the removed charge. */
+    float values[4];             /**< The values of the record, their meaning depends on the type. */
+    uint32_t check;              /**< The low 32 bits of the FNV-1a hash of the fields before it. */
+};
+
+static_assert(sizeof(LevelJournalRecord) == 28, "LevelJournalRecord must not contain padding");
+
+/**
+ * @brief The first 4 bytes of every level journal.
+ */
+const char levelJournalMagic[4] = {'C', 'H', 'G', 'J'};
+
+/**
+ * @brief The version of the level journal format written by this program.
+ */
+const uint32_t levelJournalVersion = 1;
+
+/**
+ * @brief The header at the start of a thumbnail file, levels/thumbnails/<name>.thumb.
+ *
+ * The header is followed by width * height RGBA pixels, row by row from the top. The thumbnail belongs to the
+ * level whose checksum and journal size are in the header (see LevelInfo), it is rendered again once they change.
+ */
+struct ThumbnailHeader
+{
+    char magic[4];         /**< Always thumbnailMagic. */
+    uint32_t version;      /**< The version of the format, thumbnailVersion when written. */
+    uint32_t width;        /**< The width of the thumbnail in pixels. */
+    uint32_t height;       /**< The height of the thumbnail in pixels. */
+    uint64_t checksum;     /**< The checksum of the level file the thumbnail was rendered from. */
+    uint64_t journalSize;  /**< The size of the journal of the level when the thumbnail was rendered. */
+};
+
+static_assert(sizeof(ThumbnailHeader) == 32, "ThumbnailHeader must not contain padding");
+
+/**
+ * @brief The first 4 bytes of every thumbnail file.
+ */
+const char thumbnailMagic[4] = {'C', 'H', 'G', 'T'};
+
+/**
+ * @brief The version of the thumbnail format written by this program.
+ */
+const uint32_t thumbnailVersion = 1;
@@ -1,7 +1,74 @@
+#pragma once
 #include <string>
 #include <vector>
+#include <iostream>
+#include <stdexcept>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <filesystem>
+#include <cstdint>
 
 #include <level.h>
+#include <levelData.h>
+#include <levelFormat.h>
+#include <settings.h>
+
+/**
+ * @brief The format levels are saved in unless another one is given, chosen by levelSaveFormat in settings.h.
+ */
+const LevelFormat defaultLevelFormat = levelSaveFormat == 2 ? LevelFormat::Compressed : levelSaveFormat == 1 ? LevelFormat::Binary : LevelFormat::Json;
+
+/**
+ * @brief The progress of a level load, written by the loading thread and read by the menu.
+ */
+struct LevelLoadProgress
+{
+    std::atomic<size_t> loadedBytes; /**< The number of bytes of the level file processed so far. */
+    std::atomic<size_t> totalBytes;  /**< The size of the level file, 0 until it has been opened. */
+
+    LevelLoadProgress() : loadedBytes(0), totalBytes(0) {}
+
+    /**
+     * @brief Gets the processed part of the level file.
+     * @return A number between 0 and 1.
+     */
+    float getFraction() const
+    {
+        const size_t total = totalBytes.load();
+        return total == 0 ? 0.0f : static_cast<float>(loadedBytes.load()) / total;
+    }
+};
+
+/**
+ * @brief What the level catalog knows about a level, available without opening the level file.
+ */
+struct LevelInfo
+{
+    std::string name;       /**< The name of the level. */
+    LevelFormat format;     /**< The format the level is saved in. */
+    uint64_t fileSize;      /**< The size of the level file in bytes, the journal of the level is not included. */
+    uint64_t obstacleCount; /**< The number of obstacles. */
+    float minX;             /**< The smallest x coordinate of the obstacles, 0 if there are none. The box may be too large after journaled removals. */
+    float minY;             /**< The smallest y coordinate of the obstacles, 0 if there are none. */
+    float maxX;             /**< The largest x coordinate of the obstacles, 0 if there are none. */
+    float maxY;             /**< The largest y coordinate of the obstacles, 0 if there are none. */
+    uint64_t checksum;      /**< 64 bit FNV-1a hash of the level file, the journal of the level is not included. */
+    uint64_t journalSize;   /**< The size of the journal of the level in bytes, 0 if there is none. Grows with every journaled save. */
+};
+
+/**
+ * @brief Counters of the level cache of LevelManager, for instrumentation.
+ */
+struct LevelCacheStats
+{
+    unsigned long hits;      /**< Loads served from the cache. */
+    unsigned long misses;    /**< Loads which had to read the file. */
+    unsigned long evictions; /**< Levels dropped to stay within the budget. */
+};
 
 // Singleton LevelManager class to avoid discrepencies between loadables of multiple instances
 
@@ -11,15 +78,118 @@
  *
  * The LevelManager class is responsible for managing the levels in the game. It provides
  * functionality to load, save, delete, and retrieve information about the levels.
+ *
+ * Files are read into and written from LevelData, which doesn't need a window or textures. The Level
+ * overloads are defined inline, so headless tools can use the manager without linking the graphical classes.
+ *
+ * A level is stored either as JSON or in the binary format of levelFormat.h. Binary files are memory mapped
+ * and their obstacle arrays are used by the charge store in place.
+ *
+ * Loaded levels are kept in a least recently used cache bounded by levelCacheBudget. Loading a cached level
+ * hands out a charge store which views the cached arrays and only copies them when it is edited.
  */
 class LevelManager
 {
 private:
-    std::vector<std::string> loadables; /**< A vector of strings representing the loadable levels. */
+    mutable std::vector<LevelInfo> catalog; /**< The loadable levels in the order they were created. */
+    mutable std::unordered_map<std::string, size_t> catalogIndex; /**< The position of every level in the catalog by name. */
+    mutable bool isCatalogLoaded; /**< Whether the catalog file has been read, it is read on first use. */
+    mutable bool isCatalogChanged; /**< Whether the catalog has changed since it was last written. */
+
+    /**
+     * @brief A loaded level kept in the cache.
+     */
+    struct CachedLevel
+    {
+        std::string name;                              /**< The name of the level. */
+        std::string path;                              /**< The file the level was loaded from. */
+        std::filesystem::file_time_type modified;      /**< The modification time of the file when it was loaded. */
+        std::shared_ptr<const LevelData> snapshot;     /**< The loaded level, never changed. */
+        size_t bytes;                                  /**< The memory the level is counted with against the budget. */
+    };
+
+    mutable std::list<CachedLevel> cache; /**< The cached levels, most recently used first. */
+    mutable std::unordered_map<std::string, std::list<CachedLevel>::iterator> cacheIndex; /**< The cached levels by name. */
+    mutable size_t cacheBytes;         /**< The memory used by the cached levels. */
+    mutable LevelCacheStats cacheStats; /**< The hit, miss and eviction counters. */
+    mutable std::mutex cacheMutex;      /**< Guards the cache and savedRevisions, levels are also cached by the loading threads. */
+
+    mutable std::unordered_map<std::string, unsigned long> savedRevisions; /**< The revision of the charges the files of each level hold, edits since then can be journaled. */
 
     LevelManager(); /**< Private constructor to enforce singleton pattern. */
     ~LevelManager(); /**< Destructor. */
 
+    /**
+     * @brief Read the catalog file on first use.
+     *
+     * If there is no catalog yet, it is built once from the plain list of names in levels/index.txt of earlier versions.
+     */
+    void ensureCatalog() const;
+
+    /**
+     * @brief Describe a level file for the catalog.
+     * @param data The contents of the level.
+     * @param path The path of the level file.
+     * @param format The format of the file.
+     * @return The catalog entry of the level.
+     */
+    static LevelInfo describeLevel(const LevelData &data, const std::string &path, const LevelFormat format);
+
+    /**
+     * @brief Find the file of a level in the catalog.
+     * @param levelName The name of the level.
+     * @return The path of the file.
+     * @throws std::runtime_error If the level is not in the catalog.
+     */
+    std::string findLevelFile(const std::string &levelName) const;
+
+    /**
+     * @brief Save a level by appending its edits to its journal instead of writing the level file in full.
+     *
+     * This is only possible if the files of the level hold a revision of the same charges, the edits since
+     * then are still in the delta log of the charges and the journal stays under levelJournalLimit records.
+     *
+     * @param data The level to save.
+     * @param info The catalog entry of the level, updated with the edits.
+     * @return True if the edits were journaled, false if the level file has to be written in full.
+     */
+    bool appendToJournal(const LevelData &data, LevelInfo &info);
+
+    /**
+     * @brief Look up a level in the cache and mark it as recently used.
+     *
+     * Entries whose file has been modified or replaced since they were cached are dropped.
+     *
+     * @param levelName The name of the level.
+     * @param path The file the level would be loaded from.
+     * @return The cached level, null if it isn't cached.
+     */
+    std::shared_ptr<const LevelData> findCached(const std::string &levelName, const std::string &path) const;
+
+    /**
+     * @brief Put a loaded level into the cache, evicting the least recently used levels over the budget.
+     * @param path The file the level was loaded from.
+     * @param data The loaded level.
+     * @return The snapshot the level is kept as.
+     */
+    std::shared_ptr<const LevelData> addToCache(const std::string &path, LevelData &&data) const;
+
+    /**
+     * @brief Remove a level from the cache, copies handed out earlier stay valid.
+     * @param levelName The name of the level.
+     */
+    void invalidateCached(const std::string &levelName);
+
+    /**
+     * @brief Make level data which uses the arrays of a cached snapshot until it is edited.
+     *
+     * The revision of the returned charges is remembered, so the edits made to them can be journaled when the level is saved.
+     *
+     * @param snapshot The cached level.
+     * @return The level data, its charge store views the snapshot.
+     */
+    LevelData handOut(const std::shared_ptr<const LevelData> &snapshot) const;
+
 public:
     /**
      * @brief Get the instance of the LevelManager.
@@ -28,31 +198,136 @@ public:
     static LevelManager *getInstance();
 
     /**
-     * @brief Get the list of loadable levels.
-     * @return A constant reference to the vector of loadable levels.
+     * @brief Get the number of loadable levels.
+     * @return The number of levels in the catalog.
+     */
+    size_t getLevelCount() const;
+
+    /**
+     * @brief Get the catalog entry of a level by its position.
+     * @param levelIndex The position of the level. 0 is always the oldest created level.
+     * @return The catalog entry.
+     * @throws std::out_of_range If there is no level at the position.
+     */
+    const LevelInfo &getLevelInfo(const size_t levelIndex) const;
+
+    /**
+     * @brief Look up the catalog entry of a level by its name in constant time.
+     * @param levelName The name of the level.
+     * @return The catalog entry, null if there is no such level.
+     */
+    const LevelInfo *findLevelInfo(const std::string &levelName) const;
+
+    /**
+     * @brief Get the counters of the level cache.
+     * @return The number of cache hits, misses and evictions so far.
+     */
+    LevelCacheStats getCacheStats() const;
+
+    /**
+     * @brief Get the memory used by the cached levels.
+     * @return The memory counted against levelCacheBudget in bytes.
      */
-    const std::vector<std::string>& getLoadables() const { return loadables; }
+    size_t getCacheBytes() const;
 
     /**
-     * @brief Update the index of the levels.
+     * @brief Write the catalog of the levels to levels/catalog.txt.
      *
-     * This function updates the index of the levels based on the current state of the game.
+     * The catalog is written to a temporary file which then replaces the old one, so a crash can't leave a half written catalog.
+     * Saving and deleting levels call this, it only has to be called after the catalog files were changed from outside.
      */
     void updateIndex() const;
 
+    /**
+     * @brief Get the path of the file of a level.
+     * @param levelName The name of the level.
+     * @param format The format of the file.
+     * @return The path of the file, relative to the working directory.
+     */
+    static std::string getLevelPath(const std::string &levelName, const LevelFormat format);
+
+    /**
+     * @brief Read a level file and apply the edits in its journal.
+     *
+     * Unlike loading a level, this doesn't use the catalog or the cache, so it can be called from any thread.
+     *
+     * @param levelName The name of the level.
+     * @param path The path of the level file.
+     * @param progress The progress of reading the level file is published here, can be null.
+     * @return The contents of the level.
+     * @throws std::runtime_error If the level file can't be read.
+     */
+    static LevelData readSavedLevel(const std::string &levelName, const std::string &path, LevelLoadProgress *progress);
+
+    /**
+     * @brief Read a level file in either format, without creating obstacles.
+     *
+     * The format is chosen by the extension, .lvl files are read as binary, .clvl files as compressed, every other file as JSON.
+     *
+     * @param path The path of the file.
+     * @param progress If not null, updated while the file is read.
+     * @return The level data, named after the name stored in the file.
+     * @throws std::runtime_error If the file can't be read or is malformed.
+     */
+    static LevelData readLevelFile(const std::string &path, LevelLoadProgress *progress = nullptr);
+
+    /**
+     * @brief Write a level file in the given format.
+     * @param data The level data to write.
+     * @param path The path of the file.
+     * @param format The format of the file.
+     * @throws std::runtime_error If the file can't be written.
+     */
+    static void writeLevelFile(const LevelData &data, const std::string &path, const LevelFormat format);
+
+    /**
+     * @brief Load the contents of a level by its name, without creating obstacles.
+     * @param levelName The name of the level to load.
+     * @return The loaded level data.
+     * @throws std::runtime_error If the level is not in the index or its file can't be read.
+     *
+     * The binary file of the level is preferred if both exist.
+     */
+    LevelData loadLevelData(const std::string &levelName) const;
+
+    /**
+     * @brief Load the contents of a level by its name on a background thread.
+     *
+     * The file is parsed and the charge store is built on the loading thread. Obstacles have to be created by the caller
+     * (Level(LevelData)) once the future is ready, the graphical objects are not created on other threads.
+     *
+     * @param levelName The name of the level to load.
+     * @param progress Updated by the loading thread while the file is read, may be null.
+     * @return The future of the level data. get() throws std::runtime_error if the level couldn't be loaded.
+     */
+    std::future<LevelData> loadLevelDataAsync(const std::string &levelName, const std::shared_ptr<LevelLoadProgress> &progress) const;
+
     /**
      * @brief Load a level by its name.
      * @param levelName The name of the level to load.
      * @return The loaded Level object.
      */
-    Level loadLevel(const std::string &levelName) const;
+    Level loadLevel(const std::string &levelName) const { return Level(loadLevelData(levelName)); }
 
     /**
      * @brief Load a level by its index.
      * @param levelIndex The index of the level to load. 0 is always the oldest created level.
-     * @return The loaded Level object.
+     * @return The loaded Level object, or an empty level if it couldn't be loaded.
      */
-    Level loadLevel(const size_t &levelIndex) const;
+    Level loadLevel(const size_t &levelIndex) const
+    {
+        // Catch errors occurring from overindexing, non-existent files etc...
+        // Return empty level if error occured
+        try
+        {
+            return loadLevel(getLevelInfo(levelIndex).name);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << '\n';
+            return Level();
+        }
+    }
 
     /**
      * @brief Load a default level.
@@ -60,11 +335,34 @@ public:
      */
     Level loadLevel() const { return Level(); }
 
+    /**
+     * @brief Save the contents of a level.
+     *
+     * If the level was loaded or saved before and only a few charges have been edited since, the edits are appended
+     * to the journal of the level (see levelJournalLimit in settings.h). Otherwise the level file is written in full,
+     * it replaces the old file only once it is complete, and the journal is deleted.
+     * The file of the level in the other format is deleted, so it doesn't shadow the new one.
+     * The cached copy of the level is dropped first. On Windows the files can't be replaced or deleted while they are mapped,
+     * so the charges of the data must not view a mapped level file (see ChargeStore::detach()).
+     *
+     * @param data The level data to save.
+     * @param format The format to save in (default: levelSaveFormat in settings.h).
+     */
+    void saveLevel(const LevelData &data, const LevelFormat format = defaultLevelFormat);
+
     /**
      * @brief Save a level.
+     *
+     * The level stops using the mapped file it was loaded from, so the file can be replaced.
+     *
      * @param level The Level object to save.
+     * @param format The format to save in (default: levelSaveFormat in settings.h).
      */
-    void saveLevel(const Level &level);
+    void saveLevel(Level &level, const LevelFormat format = defaultLevelFormat)
+    {
+        level.releaseLevelFile();
+        saveLevel(level.getData(), format);
+    }
 
     /**
      * @brief Delete a level by its name.
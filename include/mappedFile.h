@@ -0,0 +1,50 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+/**
+ * @class MappedFile
+ * @brief A file mapped read-only into memory.
+ *
+ * The operating system pages the contents in on demand, so large level files can be used in place
+ * without reading and copying them first. The mapping is released when the object is destroyed.
+ * On Windows the file can't be replaced or deleted until then, on other systems the mapping keeps the old contents.
+ */
+class MappedFile
+{
+private:
+    const unsigned char *data; /**< The first byte of the mapped contents. */
+    size_t size;               /**< The size of the file in bytes. */
+#ifdef _WIN32
+    void *fileHandle;    /**< Handle of the opened file. */
+    void *mappingHandle; /**< Handle of the file mapping object. */
+#endif
+
+public:
+    /**
+     * @brief Maps the whole file into memory.
+     * @param path The path of the file.
+     * @throws std::runtime_error If the file can't be opened or mapped, or it is empty.
+     */
+    explicit MappedFile(const std::string &path);
+
+    /**
+     * @brief Unmaps the file.
+     */
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /**
+     * @brief Gets the contents of the file.
+     * @return Pointer to the first byte, aligned to a page boundary.
+     */
+    const unsigned char *getData() const { return data; }
+
+    /**
+     * @brief Gets the size of the file.
+     * @return The size of the file in bytes.
+     */
+    size_t getSize() const { return size; }
+};
@@ -10,7 +10,8 @@
  * @brief Represents an obstacle in the program.
  * 
  * This class is derived from the Charge class and represents an obstacle as a circle (similar to a point charge).
- * It contains an sf::CircleShape object to represent the body of the obstacle.
+ * It contains an sf::CircleShape object to represent the body of the obstacle. The body is used for finding the
+ * obstacle in the editor, obstacles are drawn by ObstacleRenderer from the charge store of the level.
  */
 class Obstacle : public Charge
 {
@@ -18,31 +19,9 @@ private:
 
     const float collisionBox; /**< The collision box of the obstacle */
     std::shared_ptr<sf::CircleShape> body; /**< The body of the obstacle */
-    
-    sf::Vector2f vectorToPlayer; /**< The vector pointing from the obstacle to the player */
-    float distanceSquaredToPlayer; /**< The distance to the player */
 
     ObstacleAnimation animation; /**< The animation of the obstacle */
 
-    /**
-     * @brief Sets the distance to the player.
-     * 
-     * @param newDistance The new distance to the player.
-     */
-    void updateDistanceSquaredToPlayer();
-
-    /**
-     * @brief Updates the vector pointing from the obstacle to the player.
-     *
-     */
-    void updateVectorToPlayer();
-
-    /**
-     * @brief Updates the animation of the obstacle.
-     * 
-     */
-    void updateAnimation() {animation.applyTransform(*this);}
-
 public:
 
     /**
@@ -74,25 +53,4 @@ public:
      * @param newPos The new position of the obstacle.
      */
     void setPosition(sf::Vector2f &newPos) override;
-
-    /**
-     * @brief Returns the vector pointing from the obstacle to the player.
-     * 
-     * @return const sf::Vector2f& The vector pointing from the obstacle to the player.
-     */
-    const sf::Vector2f &getVectorToPlayer() const { return vectorToPlayer; }
-
-    void updateObstacle()
-    {
-        updateVectorToPlayer();
-        updateDistanceSquaredToPlayer();
-        updateAnimation();
-    }
-
-    /**
-     * @brief Returns the distance squared to the player.
-     * 
-     * @return float The distance to the player.
-     */
-    float getDistanceSquaredToPlayer() const { return distanceSquaredToPlayer; }
 };
\ No newline at end of file
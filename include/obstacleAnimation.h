@@ -21,4 +21,12 @@ public:
      * @param transform The transform to apply.
      */
     void applyTransform(Charge &toTransform) const override;
+
+    /**
+     * @brief Gets the brightness and scale of an obstacle, obstacles close to the player are drawn bigger and brighter.
+     *
+     * @param distanceSquared The distance squared from the obstacle to the player.
+     * @return The factor of the color and the scale of the obstacle, between 0.65 and 1.
+     */
+    static float getColorCorrection(const float distanceSquared);
 };
\ No newline at end of file
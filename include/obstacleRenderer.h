@@ -0,0 +1,44 @@
+#pragma once
+#include <SFML\Graphics.hpp>
+
+#include "chargeStore.h"
+
+/**
+ * @class ObstacleRenderer
+ * @brief Draws every obstacle of a level in a single draw call.
+ *
+ * Drawing the body of every obstacle separately costs a draw call per obstacle and tessellates a circle for each of them.
+ * The renderer instead builds one textured quad per charge (two triangles) into a single vertex array. The textures of
+ * both kinds of obstacles are areas of the texture atlas of Animation, so a frame costs one draw call whatever the number
+ * of charges, and the player, which is drawn with the same atlas, doesn't switch textures either.
+ *
+ * The quads are built from the charge store, they are sized and tinted like the bodies of the obstacles.
+ */
+class ObstacleRenderer : public sf::Drawable
+{
+private:
+    sf::VertexArray vertices; /**< The quads of the charges in the order of the charge store. */
+
+    /**
+     * @brief Draws the vertex array with the texture atlas.
+     * @param target The target to draw to.
+     * @param states The render states, the texture is replaced.
+     */
+    void draw(sf::RenderTarget &target, sf::RenderStates states) const override;
+
+public:
+    /**
+     * @brief Constructs a renderer without obstacles.
+     */
+    ObstacleRenderer();
+
+    /**
+     * @brief Rebuilds the quads of every charge.
+     *
+     * Obstacles closer to the player are drawn bigger and brighter, see ObstacleAnimation::getColorCorrection().
+     *
+     * @param charges The charges of the level.
+     * @param playerPos The position of the player.
+     */
+    void update(const ChargeStore &charges, const sf::Vector2f &playerPos);
+};
@@ -1,8 +1,14 @@
 #pragma once
+#include <SFML\System.hpp>
 #include <vector>
 
-#include "player.h"
-#include "obstacle.h"
+#include "chargeStore.h"
+#include "forceKernel.h"
+#include "chargeQuadtree.h"
+#include "fieldGrid.h"
+#include "spatialHash.h"
+#include "playerState.h"
+#include "simulationContext.h"
 
 /**
  * @class PhysicsEngine
@@ -10,31 +16,151 @@
  *
  * The PhysicsEngine class provides functionality for calculating electric forces, friction forces,
  * and checking collisions. It also allows updating the player's physics state.
+ *
+ * The engine only works on the charge store of a level and the state of the player, it doesn't depend on
+ * the window, the textures or the global game objects, so it can run headless (see tools/headless.cpp).
  */
 class PhysicsEngine
 {
+public:
+    /**
+     * @brief The algorithms the electric force can be calculated with.
+     */
+    enum class Solver
+    {
+        Direct,    /**< Exact sum over every obstacle, O(N). */
+        BarnesHut, /**< Quadtree of charge moments, O(log N) approximation. */
+        FieldGrid  /**< Interpolated lookup in a precomputed field, O(1). */
+    };
+
+    /**
+     * @brief The numerical methods the movement of the player can be integrated with.
+     */
+    enum class Integrator
+    {
+        ExplicitEuler,     /**< First order, 1 force evaluation per step. */
+        SemiImplicitEuler, /**< First order, symplectic, 1 force evaluation per step. */
+        VelocityVerlet,    /**< Second order, symplectic, 1 force evaluation per step. */
+        RK4,               /**< Classic fourth order Runge-Kutta, 4 force evaluations per step. */
+        RK45               /**< Adaptive Dormand-Prince 5(4) with error control, 6 force evaluations per substep. */
+    };
+
 private:
     // Physical constants
     const float k; ///< Coulomb constant
     const float frictionCoeff; ///< Coefficient of friction
     const float g; ///< Acceleration due to gravity
 
+    ForceKernel forceKernel; ///< Instruction set used for summing the electric field of the obstacles
+
+    const ChargeStore *charges; ///< The obstacles the player is simulated against
+    sf::Vector2u bounds; ///< The size of the level, the player bounces off its walls
+
+    Solver solver; ///< Algorithm used for calculating the electric force
+    float openingAngle; ///< Opening angle (theta) of the Barnes-Hut solver
+    ChargeQuadtree quadtree; ///< Quadtree of the obstacles used by the Barnes-Hut solver
+    ::FieldGrid fieldGrid; ///< Precomputed field of the obstacles used by the field grid solver
+    float fieldGridCellSize; ///< Distance between the nodes of the field grid in pixels
+    ::FieldGrid::Interpolation fieldGridInterpolation; ///< Interpolation used between the nodes of the field grid
+    SpatialHash collisionHash; ///< Collision circles of the obstacles, only the ones near the path of the player are checked
+    unsigned long preparedRevision; ///< Revision of the level the data structures were built from
+    sf::Vector2u preparedSize; ///< Size of the level the data structures were built for
+
+    Integrator integrator; ///< Numerical method used for advancing the player
+    float adaptiveTolerance; ///< Error tolerance of the adaptive integrator
+
+    SimulationContext playerContext; ///< Context of the player simulated by step()
+
+    static const ChargeStore noCharges; ///< Bound until setCharges() is called
+
     /**
-     * @brief Calculates the electric force acting on an object by all obstacles and sums them.
+     * @brief Calculates the electric force acting on the player by all obstacles and sums them.
+     * @param pos The position of the player.
+     * @param electricCharge The electric charge of the player.
      * @return The electric force as a 2D vector (sf::Vector2f).
      */
-    const sf::Vector2f calculateElectricForce() const;
+    const sf::Vector2f calculateElectricForce(const sf::Vector2f &pos, const double electricCharge) const;
 
     /**
-     * @brief Calculates the friction force acting on an object.
+     * @brief Calculates the friction force acting on the player.
+     * @param speed The speed of the player.
+     * @param mass The mass of the player.
      * @return The friction force as a 2D vector.
      */
-    const sf::Vector2f calculateFrictionForce() const;
+    const sf::Vector2f calculateFrictionForce(const sf::Vector2f &speed, const double mass) const;
+
+    /**
+     * @brief Calculates the acceleration of the player in the given state.
+     * @param state The position and speed of the player.
+     * @param context The context the player belongs to, its force evaluation counter is incremented.
+     * @return The acceleration of the player.
+     */
+    sf::Vector2f calculateAcceleration(const PlayerState &state, SimulationContext &context) const;
 
     /**
-     * @brief Checks for collisions between Player and walls and obstacles.
+     * @brief Calculates the acceleration of several players at once.
+     *
+     * The direct solver evaluates the positions together with the lane kernels, the other solvers one by one.
+     *
+     * @param states The position and speed of every player.
+     * @param simulations The contexts the players belong to, their force evaluation counters are incremented.
+     * @param count The number of players, at most simulationLaneCount.
+     * @param accelerations The accelerations of the players are written here.
      */
-    void checkCollision();
+    void calculateAccelerations(const PlayerState *states, SimulationContext *const *simulations, const size_t count, sf::Vector2f *accelerations) const;
+
+    /**
+     * @brief Advances the states of several players in lockstep with the selected integrator.
+     *
+     * Every stage of the integrator evaluates the forces of every player with one calculateAccelerations() call.
+     * Must not be called with the adaptive integrator, its substeps differ between the players.
+     *
+     * @param simulations The contexts of the players, hold the data cached by the integrators.
+     * @param count The number of players, at most simulationLaneCount.
+     * @param timeStep The simulated time of the step in seconds.
+     * @param next The states at the end of the step are written here.
+     */
+    void integrateLanes(SimulationContext *const *simulations, const size_t count, const float timeStep, PlayerState *next) const;
+
+    /**
+     * @brief Limits the speed of an advanced player and checks its collisions.
+     * @param simulation The context of the player, its state has already been advanced.
+     * @param start The position of the player before the step.
+     * @return True if the player hit an obstacle, false otherwise.
+     */
+    bool finishStep(SimulationContext &simulation, const sf::Vector2f &start) const;
+
+    /**
+     * @brief Advances the state of the player with the selected integrator.
+     * @param state The state at the start of the step.
+     * @param timeStep The simulated time of the step in seconds.
+     * @param context The context the player belongs to, holds the data cached by the integrators.
+     * @return The state at the end of the step.
+     */
+    PlayerState integrate(const PlayerState &state, const float timeStep, SimulationContext &context) const;
+
+    /**
+     * @brief Advances the state with the adaptive Dormand-Prince method, in as many substeps as the error tolerance requires.
+     * @param state The state at the start of the step.
+     * @param timeStep The simulated time of the step in seconds.
+     * @param context The context the player belongs to, holds the length of the last substep.
+     * @return The state at the end of the step.
+     */
+    PlayerState integrateAdaptive(const PlayerState &state, const float timeStep, SimulationContext &context) const;
+
+    /**
+     * @brief Checks for collisions between the player and walls and obstacles.
+     *
+     * The player is swept along the straight path of the step, so it can't pass through an obstacle in a single
+     * step at high speed. Only the obstacles hashed near the path are checked, the cost doesn't depend on the
+     * size of the level. The player bounces off the walls of the level, the speed is updated in the state.
+     *
+     * @param state The state of the player after the step.
+     * @param start The position of the player before the step.
+     * @param playerRadius The collision radius of the player.
+     * @return True if the player hit an obstacle, false otherwise.
+     */
+    bool checkCollision(PlayerState &state, const sf::Vector2f &start, const float playerRadius) const;
 
 public:
     /**
@@ -46,7 +172,164 @@ public:
     PhysicsEngine(const float coulombConst = 8.988e2f, const float frictionCoeff = 10.0f, const float g = 9.81f);
 
     /**
-     * @brief Updates the player's movement.
+     * @brief Sets the obstacles and the walls the player is simulated against.
+     *
+     * The store must outlive the engine or be replaced before it is destroyed. Edits of the store are
+     * picked up by synchronize() on the next step.
+     *
+     * @param newCharges The charge store of the level.
+     * @param newBounds The size of the level.
+     */
+    void setCharges(const ChargeStore &newCharges, const sf::Vector2u &newBounds);
+
+    /**
+     * @brief Sets the physical traits of the simulated player.
+     * @param newTraits The electric charge, mass and collision radius of the player.
+     */
+    void setPlayerTraits(const PlayerTraits &newTraits) { playerContext.traits = newTraits; }
+
+    /**
+     * @brief Sets the algorithm used for calculating the electric force.
+     * @param newSolver The new solver.
+     */
+    void setSolver(const Solver newSolver);
+
+    /**
+     * @brief Gets the algorithm used for calculating the electric force.
+     * @return The solver.
+     */
+    Solver getSolver() const { return solver; }
+
+    /**
+     * @brief Sets the numerical method used for advancing the player.
+     * @param newIntegrator The new integrator.
+     */
+    void setIntegrator(const Integrator newIntegrator);
+
+    /**
+     * @brief Gets the numerical method used for advancing the player.
+     * @return The integrator.
+     */
+    Integrator getIntegrator() const { return integrator; }
+
+    /**
+     * @brief Sets the error tolerance of the adaptive integrator.
+     * @param tolerance The allowed local error per substep, in pixels and pixels per second.
+     */
+    void setAdaptiveTolerance(const float tolerance) { adaptiveTolerance = tolerance; }
+
+    /**
+     * @brief Gets the number of force evaluations done by step() since construction.
+     *
+     * Useful for comparing the cost of integrators at equal accuracy.
+     *
+     * @return The number of force evaluations.
+     */
+    unsigned long getForceEvaluationCount() const { return playerContext.forceEvaluations; }
+
+    /**
+     * @brief Sets the opening angle (theta) of the Barnes-Hut solver.
+     * @param newOpeningAngle The new opening angle. 0 gives the exact sum.
+     */
+    void setOpeningAngle(const float newOpeningAngle) { openingAngle = newOpeningAngle; }
+
+    /**
+     * @brief Sets the resolution and interpolation of the field grid solver.
+     *
+     * The grid is baked again on the next update.
+     *
+     * @param cellSize The distance between two neighbouring nodes in pixels.
+     * @param interpolation The interpolation used between the nodes.
+     */
+    void setFieldGrid(const float cellSize, const ::FieldGrid::Interpolation interpolation);
+
+    /**
+     * @brief Builds the data structures of the selected solver and the collision hash from the bound charge store.
+     *
+     * Called by synchronize() when the store has been replaced, cleared or resized.
+     */
+    void prepare();
+
+    /**
+     * @brief Brings the data structures of the selected solver up to date with the bound charge store.
+     *
+     * Edits of the obstacles made since the last update are applied one by one with applyChargeDelta(),
+     * so painting in the editor costs O(edit) instead of a rebuild from every obstacle. If the store has been
+     * replaced, cleared or resized, or the edits can't be applied, prepare() is called instead.
+     */
+    void synchronize();
+
+    /**
+     * @brief Applies a single edit of the obstacles to the data structures of the selected solver.
+     *
+     * The field grid adds or subtracts the field of the charge at every node, the quadtree inserts or removes
+     * the charge and updates the moments on the path to its leaf. The collision hash inserts or removes its circle.
+     *
+     * @param delta The edit to apply.
+     * @return False if the edit couldn't be applied and the data structures have to be rebuilt, true otherwise.
+     */
+    bool applyChargeDelta(const ChargeDelta &delta);
+
+    /**
+     * @brief Calculates the relative error of the Barnes-Hut solver compared to the exact sum at the given position.
+     * @param pos The position the two forces are compared at.
+     * @return The length of the difference of the two forces divided by the length of the exact force.
+     */
+    float measureBarnesHutError(const sf::Vector2f &pos) const;
+
+    /**
+     * @brief Sets the kernel used for summing the electric field of the obstacles.
+     *
+     * By default the widest kernel supported by the CPU is used. The scalar kernel can be selected
+     * to get reference results.
+     *
+     * @param kernel The force kernel. Must be supported by the CPU.
+     */
+    void setForceKernel(const ForceKernel kernel) { forceKernel = kernel; }
+
+    /**
+     * @brief Gets the kernel used for summing the electric field of the obstacles.
+     * @return The force kernel.
+     */
+    ForceKernel getForceKernel() const { return forceKernel; }
+
+    /**
+     * @brief Advances the player by one simulation step.
+     *
+     * The speed is limited to playerMaxSpeed and reflected at the walls of the level.
+     *
+     * @param state The state of the player, updated in place.
+     * @param timeStep The simulated time of the step in seconds.
+     * @return True if the player hit an obstacle, false otherwise.
+     */
+    bool step(PlayerState &state, const float timeStep);
+
+    /**
+     * @brief Advances a simulation context by one simulation step.
+     *
+     * Unlike step() this doesn't update the solver data structures, it only reads the engine, so it can be
+     * called for different contexts from several threads at once. prepare() or synchronize() must have been
+     * called after the last change of the charges, and the engine must not be changed while contexts are advanced.
+     *
+     * @param simulation The context of the player, updated in place.
+     * @param timeStep The simulated time of the step in seconds.
+     * @return True if the player hit an obstacle, false otherwise.
+     */
+    bool advance(SimulationContext &simulation, const float timeStep) const;
+
+    /**
+     * @brief Advances several simulation contexts by one simulation step in lockstep.
+     *
+     * Gives the same result as calling advance() for every context up to floating point rounding, but the direct
+     * solver evaluates the forces of every player in one pass over the obstacles, so launch parameter sweeps are
+     * bound by arithmetic instead of memory bandwidth. The result of a context doesn't depend on the other contexts
+     * of the call. The adaptive integrator advances the contexts one by one.
+     *
+     * The same rules apply as for advance(), the contexts can be advanced from several threads at once.
+     *
+     * @param simulations The contexts of the players, updated in place.
+     * @param count The number of contexts.
+     * @param timeStep The simulated time of the step in seconds.
      */
-    void updatePlayer();
+    void advanceLanes(SimulationContext *const *simulations, const size_t count, const float timeStep) const;
 };
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include "charge.h"
 #include "playerAnimation.h"
+#include "playerState.h"
 
 /**
  * @class Player
@@ -16,6 +17,8 @@ class Player : public Charge
 {
 private:
     sf::Vector2f speed; /**< The speed of the player. */
+    sf::Vector2f position; /**< The position of the player in the simulation. */
+    sf::Vector2f previousPosition; /**< The position of the player before the last simulation step. */
     const double mass; /**< The mass of the player. */
 
     const float collisionRadius; /**< The collision box of the player. */
@@ -48,6 +51,23 @@ public:
      */
     sf::Vector2f getSpeed() const { return speed; }
 
+    /**
+     * @brief Gets the position of the player in the simulation.
+     *
+     * The body of the player is drawn at a position interpolated between the last two simulation steps,
+     * physics calculations must use this position instead.
+     *
+     * @return The position of the player.
+     */
+    const sf::Vector2f &getPosition() const { return position; }
+
+    /**
+     * @brief Gets the physical traits of the player used by the physics engine.
+     *
+     * @return The electric charge, mass and collision radius of the player.
+     */
+    PlayerTraits getTraits() const { return PlayerTraits{getElectricCharge(), mass, collisionRadius}; }
+
     /**
      * @brief Gets the collision box of the player.
      * 
@@ -77,9 +97,26 @@ public:
     void setSpeed(const sf::Vector2f &newSpeed);
 
     /**
-     * @brief Updates the movement of the player based on the given acceleration.
+     * @brief Gets the position and speed of the player.
+     *
+     * @return The kinematic state of the player.
+     */
+    PlayerState getState() const { return PlayerState{position, speed}; }
+
+    /**
+     * @brief Updates the movement of the player to the state calculated by the integrator.
      * 
-     * @param acceleration The acceleration to apply to the player's movement.
+     * @param newState The position and speed of the player after the simulation step.
+     */
+    void updateMovement(const PlayerState &newState);
+
+    /**
+     * @brief Moves the body of the player between the positions of the last two simulation steps and updates its animation.
+     *
+     * Rendering happens at a different rate than the fixed simulation steps, so the body is drawn at the state
+     * the time left in the accumulator corresponds to.
+     *
+     * @param alpha The fraction of a simulation step elapsed since the last step, between 0 and 1.
      */
-    void updateMovement(const sf::Vector2f &acceleration);
+    void interpolate(const float alpha);
 };
\ No newline at end of file
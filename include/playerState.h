@@ -0,0 +1,21 @@
+#pragma once
+#include <SFML\System.hpp>
+
+/**
+ * @brief The kinematic state of the player the integrators advance.
+ */
+struct PlayerState
+{
+    sf::Vector2f position; /**< The position of the player. */
+    sf::Vector2f speed;    /**< The speed of the player. */
+};
+
+/**
+ * @brief The physical traits of the player the forces depend on.
+ */
+struct PlayerTraits
+{
+    double electricCharge; /**< The electric charge of the player. */
+    double mass;           /**< The mass of the player. */
+    float collisionRadius; /**< The collision radius of the player. */
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include <chrono>
+#include <cstddef>
 
 // DEBUG LEVELS:
 // 0:   None
@@ -10,9 +11,82 @@
 // 5:   Debug LevelManager: level loading/saving
 // 6:   Display menu items
 // 7:   Print obstacle positions relative to player
+// 8:   Print error of the approximated electric force compared to the exact sum
+// 9:   Print the work done by the field overlay and the field line tracer
 
 const char debug = 0;
 
+// PHYSICS SOLVERS:
+// 0:   Direct summation over every obstacle, exact
+// 1:   Barnes-Hut quadtree, O(log N) approximation for levels with a very large number of charges
+// 2:   Precomputed field grid, O(1) interpolated lookup, baked when the game starts
+
+const char physicsSolver = 0;
+
+/**
+ * @brief The opening angle (theta) of the Barnes-Hut solver.
+ *
+ * Cells of the quadtree which look smaller than this angle from the player are approximated by their charge moments.
+ * 0 gives the exact sum, larger values are faster, but less accurate. 0.5 is a common compromise.
+ */
+const float barnesHutOpeningAngle = 0.5f;
+
+/**
+ * @brief The distance between the nodes of the precomputed field grid in pixels.
+ */
+const float fieldGridResolution = 4.0f;
+
+/**
+ * @brief The interpolation order of the precomputed field grid.
+ *
+ * 1 means bilinear, 3 means bicubic interpolation.
+ */
+const char fieldGridInterpolationOrder = 3;
+
+/**
+ * @brief The maximum number of obstacle edits a level remembers.
+ *
+ * Data structures derived from the obstacles (quadtree, field grid) apply the edits made in the editor one by one.
+ * If more edits happened since they were last updated, they are rebuilt from scratch instead.
+ */
+const size_t maxChargeDeltas = 4096;
+
+/**
+ * @brief The side length of the cells of the spatial hash the editor finds obstacles with, in pixels.
+ *
+ * About the diameter of an obstacle, so the mouse only reaches into a few cells.
+ */
+const float spatialHashCellSize = 64.0f;
+
+/**
+ * @brief The side length of the cells of the spatial hash the physics engine checks collisions with, in pixels.
+ *
+ * About the diameter of a collision circle, a step of the player only reaches into a few cells.
+ */
+const float collisionHashCellSize = 16.0f;
+
+/**
+ * @brief The memory the level manager may use for keeping loaded levels, in bytes.
+ *
+ * Returning to a level which is still cached doesn't read its file again. Every obstacle takes 16 bytes.
+ */
+const size_t levelCacheBudget = 64 * 1024 * 1024;
+
+/**
+ * @brief The number of records the journal of a level may hold before the next save writes the level file in full.
+ *
+ * Saving a level after a few edits only appends the edits to its journal, loading it applies them again.
+ * Removing a charge while the journal is applied moves the charges after it, so the journal is kept short.
+ */
+const size_t levelJournalLimit = 256;
+
+// LEVEL FORMATS:
+// 0:   JSON, human readable
+// 1:   Binary, memory mapped when loaded (see levelFormat.h)
+// 2:   Compressed, smallest files, positions rounded to 1/256 pixel (see levelFormat.h)
+
+const char levelSaveFormat = 0;
+
 // Target framerate for drawing frames
 /**
  * @brief The target framerate for the application.
@@ -22,6 +96,13 @@ const char debug = 0;
  */
 const unsigned int targetFramerate = 60;
 
+/**
+ * @brief How often the menus check on background work (previews, level loading) while waiting for input.
+ *
+ * Menus without background work block until the next event instead.
+ */
+const std::chrono::milliseconds menuPollInterval(50);
+
 // Window settings
 
 /**
@@ -38,6 +119,53 @@ const unsigned windowHeight = 512.0f;
  */
 const unsigned windowWidth = 1024.f;
 
+/**
+ * @brief The simulated time of one physics step in seconds.
+ *
+ * The simulation runs in fixed steps independent of the framerate. Every rendered frame runs as many steps
+ * as fit into the time elapsed since the last frame, the player is drawn interpolated between the last two steps.
+ */
+const float simulationTimeStep = 1.0f / 240.0f;
+
+/**
+ * @brief The maximum number of physics steps run per rendered frame.
+ *
+ * If a frame took longer (window dragging, slow machine), the rest of the elapsed time is dropped
+ * instead of trying to catch up, which would only make the next frame even slower.
+ */
+const unsigned maxSimulationStepsPerFrame = 32;
+
+// INTEGRATORS:
+// 0:   Explicit Euler
+// 1:   Semi-implicit (symplectic) Euler
+// 2:   Velocity Verlet
+// 3:   Classic Runge-Kutta (RK4)
+// 4:   Adaptive Dormand-Prince (RK45), substeps the fixed time step as the error tolerance requires
+
+const char physicsIntegrator = 1;
+
+/**
+ * @brief The allowed local error of one substep of the adaptive integrator.
+ *
+ * Measured in pixels for the position and in pixels per second (relative to the speed) for the speed.
+ */
+const float integratorTolerance = 1e-3f;
+
+/**
+ * @brief The shortest substep the adaptive integrator takes in seconds.
+ *
+ * Steps this short are accepted regardless of their error, so the simulation can't get stuck near a charge.
+ */
+const float minAdaptiveTimeStep = 1e-6f;
+
+/**
+ * @brief The maximum number of players the batch evaluator advances in lockstep against the obstacles.
+ *
+ * The positions of these players are evaluated together by the lane kernels, so every obstacle is loaded once
+ * for the whole group instead of once per player. Multiples of 8 fill every AVX2 lane.
+ */
+const size_t simulationLaneCount = 32;
+
 /**
  * @brief The maximum speed for the player.
  *
@@ -60,6 +188,108 @@ const float arrowWidth = 5.0f;
  */
 const unsigned menuTitleSize = 72;
 
+/**
+ * @brief The number of levels on one page of the main menu.
+ *
+ * The menu shows them in a grid of 3 columns.
+ */
+const size_t menuPageSize = 6;
+
+/**
+ * @brief The width of the level previews in the main menu, in pixels.
+ */
+const unsigned thumbnailWidth = 96;
+
+/**
+ * @brief The height of the level previews in the main menu, in pixels.
+ */
+const unsigned thumbnailHeight = 48;
+
+/**
+ * @brief The transparent gap around the textures packed into the texture atlas, in pixels.
+ *
+ * Smoothed textures sample their neighbouring pixels at the edges, the gap keeps the textures from bleeding into each other.
+ */
+const unsigned textureAtlasPadding = 2;
+
+/**
+ * @brief The distance between the samples of the field overlay, in pixels.
+ *
+ * The field and potential are calculated once per sample and the texture is stretched over the level with smoothing.
+ */
+const unsigned fieldOverlayCellSize = 4;
+
+/**
+ * @brief The width and height of the tiles of the field overlay, in samples.
+ *
+ * The tiles are split between the threads and only the tiles which changed are uploaded to the texture.
+ */
+const unsigned fieldOverlayTileSize = 32;
+
+/**
+ * @brief The potential at which the field overlay shows half of its full red or blue.
+ */
+const float fieldOverlayPotentialScale = 50.0f;
+
+/**
+ * @brief The field strength at which the field overlay shows half of its full green.
+ */
+const float fieldOverlayFieldScale = 1.0f;
+
+/**
+ * @brief The opacity of the field overlay, from 0 to 255.
+ */
+const unsigned char fieldOverlayAlpha = 192;
+
+/**
+ * @brief Added to the squared distances by the field overlay, in pixels squared, so samples on a charge stay finite.
+ */
+const float fieldOverlaySoftening = 1.0f;
+
+/**
+ * @brief The number of obstacle edits the field overlay adds to its samples before it sums every charge again.
+ *
+ * Adding and subtracting the field of every edited charge accumulates rounding errors, most of all where a charge was removed.
+ */
+const size_t fieldOverlayRefreshEdits = 1024;
+
+/**
+ * @brief The maximum number of field lines traced in a level.
+ *
+ * Levels with more charges than fit into the budget are seeded from every n-th charge only.
+ */
+const size_t fieldLineMaxLines = 512;
+
+/**
+ * @brief The maximum number of points of a field line, the line is cut off after them.
+ */
+const size_t fieldLineMaxPoints = 400;
+
+/**
+ * @brief The number of field lines seeded around a charge, evenly spaced by angle.
+ */
+const unsigned fieldLinesPerCharge = 8;
+
+/**
+ * @brief The largest error of a step of the field line tracer, in pixels.
+ */
+const float fieldLineTolerance = 0.1f;
+
+/**
+ * @brief The longest step of the field line tracer, in pixels.
+ */
+const float fieldLineMaxStep = 16.0f;
+
+/**
+ * @brief The shortest step of the field line tracer, in pixels. A line ends once it needs shorter steps, this happens as it runs into a charge.
+ */
+const float fieldLineMinStep = 0.05f;
+
+/**
+ * @brief The opacity of the field lines, from 0 to 255.
+ */
+const unsigned char fieldLineAlpha = 140;
+
 // Level name max character limit
 /**
  * @brief The maximum number of characters allowed for a level name.
@@ -0,0 +1,47 @@
+#pragma once
+#include <SFML\System.hpp>
+
+#include "playerState.h"
+
+/**
+ * @brief Everything that changes while a single player is simulated.
+ *
+ * The physics engine only reads its solver data while advancing a context, so any number of contexts
+ * can be advanced at the same time by different threads against the same prepared engine.
+ */
+struct SimulationContext
+{
+    PlayerState state;   /**< The position and speed of the player. */
+    PlayerTraits traits; /**< The charge, mass and collision radius of the player. */
+
+    unsigned long steps;            /**< The number of steps simulated. */
+    unsigned long forceEvaluations; /**< The number of force evaluations done by the integrators. */
+    bool isHit;                     /**< Whether the player hit an obstacle in the last step. */
+
+    float adaptiveStep;               /**< Length of the last successful substep of the adaptive integrator, 0 if there was none. */
+    PlayerState verletState;          /**< State the cached Velocity Verlet acceleration belongs to. */
+    sf::Vector2f verletAcceleration;  /**< Acceleration calculated at the end of the last Velocity Verlet step. */
+    bool isVerletCacheValid;          /**< Whether verletAcceleration can be reused. */
+
+    /**
+     * @brief Constructs a context for a player starting in the given state.
+     * @param startState The position and launch velocity of the player.
+     * @param playerTraits The charge, mass and collision radius of the player.
+     */
+    SimulationContext(const PlayerState &startState = PlayerState{}, const PlayerTraits &playerTraits = PlayerTraits{1.0, 15.0, 7.0})
+        : state(startState), traits(playerTraits), steps(0), forceEvaluations(0), isHit(false),
+          adaptiveStep(0.0f), isVerletCacheValid(false)
+    {
+    }
+
+    /**
+     * @brief Drops the data the integrators cached from earlier steps.
+     *
+     * Must be called when the obstacles changed or the state was set from outside.
+     */
+    void invalidateCache()
+    {
+        isVerletCacheValid = false;
+        adaptiveStep = 0.0f;
+    }
+};
@@ -0,0 +1,153 @@
+#pragma once
+#include <SFML\System.hpp>
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class SpatialHash
+ * @brief Uniform grid of square cells over a set of indexed circles.
+ *
+ * Every circle is stored in the cell of its center, only the cells reached by a query are visited, so a query
+ * costs O(k) for the k circles near it instead of a pass over every circle. Empty cells take no memory, the
+ * circles may lie anywhere. Circles are identified by the index of the element they belong to (an obstacle of a
+ * level, a charge of a store), and the index can be renamed when the element is moved by a swap-and-pop removal.
+ */
+class SpatialHash
+{
+private:
+    /**
+     * @brief A circle stored in a cell.
+     */
+    struct Entry
+    {
+        size_t index; /**< The index of the element the circle belongs to. */
+        float x;      /**< The x coordinate of the center. */
+        float y;      /**< The y coordinate of the center. */
+        float radius; /**< The radius of the circle. */
+    };
+
+    float cellSize;                                       /**< The side length of the cells. */
+    float maxRadius;                                      /**< The largest radius inserted since the hash was cleared. */
+    size_t count;                                         /**< The number of circles in the hash. */
+    std::unordered_map<uint64_t, std::vector<Entry>> cells; /**< The circles of every non empty cell, by cell key. */
+
+    /**
+     * @brief The cells a query has to visit.
+     */
+    struct CellRange
+    {
+        int32_t firstColumn; /**< The first column of the range. */
+        int32_t lastColumn;  /**< The last column of the range, inclusive. */
+        int32_t firstRow;    /**< The first row of the range. */
+        int32_t lastRow;     /**< The last row of the range, inclusive. */
+        bool isEveryCell;    /**< Whether the range has more cells than the hash has non empty cells, which are visited instead. */
+    };
+
+    /**
+     * @brief Gets the cell coordinate of a coordinate.
+     *
+     * The result is clamped to a range that can't overflow, coordinates beyond it (and NaN) belong to the outermost cells.
+     *
+     * @param coordinate The x or y coordinate.
+     * @return The column or row of the cell.
+     */
+    int32_t toCell(const float coordinate) const;
+
+    /**
+     * @brief Gets the cells overlapping a box.
+     * @param min The corner of the box with the smallest coordinates.
+     * @param max The corner of the box with the largest coordinates.
+     * @return The range of cells to visit.
+     */
+    CellRange getCellRange(const sf::Vector2f &min, const sf::Vector2f &max) const;
+
+    /**
+     * @brief Packs the column and row of a cell into a key.
+     * @param column The column of the cell.
+     * @param row The row of the cell.
+     * @return The key of the cell.
+     */
+    static uint64_t toKey(const int32_t column, const int32_t row);
+
+public:
+    /**
+     * @brief Constructs an empty hash.
+     * @param cellSize The side length of the cells, about the diameter of the circles works best.
+     */
+    explicit SpatialHash(const float cellSize);
+
+    /**
+     * @brief Adds a circle.
+     * @param index The index of the element the circle belongs to.
+     * @param pos The center of the circle.
+     * @param radius The radius of the circle.
+     */
+    void insert(const size_t index, const sf::Vector2f &pos, const float radius);
+
+    /**
+     * @brief Removes a circle.
+     * @param index The index of the element the circle belongs to.
+     * @param pos The center the circle was inserted with.
+     * @return True if the circle was found.
+     */
+    bool remove(const size_t index, const sf::Vector2f &pos);
+
+    /**
+     * @brief Removes a circle by its center and radius, whichever index it was inserted with.
+     * @param pos The center the circle was inserted with.
+     * @param radius The radius the circle was inserted with.
+     * @return True if the circle was found.
+     */
+    bool removeCircle(const sf::Vector2f &pos, const float radius);
+
+    /**
+     * @brief Changes the index of a circle, after its element has been moved to another index.
+     * @param oldIndex The index the circle was inserted with.
+     * @param newIndex The new index of the element.
+     * @param pos The center of the circle.
+     * @return True if the circle was found.
+     */
+    bool rename(const size_t oldIndex, const size_t newIndex, const sf::Vector2f &pos);
+
+    /**
+     * @brief Removes every circle.
+     */
+    void clear();
+
+    /**
+     * @brief Finds the circles overlapping a disc.
+     * @param center The center of the disc.
+     * @param radius The radius of the disc.
+     * @param result The indices of the circles reaching into the disc are appended to this vector, in no particular order.
+     *                Nothing is appended if the center or the radius isn't finite.
+     */
+    void queryRadius(const sf::Vector2f &center, const float radius, std::vector<size_t> &result) const;
+
+    /**
+     * @brief Finds the circles containing a point.
+     * @param pos The point.
+     * @param result The indices of the circles containing the point are appended to this vector, in no particular order.
+     */
+    void queryPoint(const sf::Vector2f &pos, std::vector<size_t> &result) const { queryRadius(pos, 0.0f, result); }
+
+    /**
+     * @brief Checks whether a circle moving along a segment touches any circle of the hash.
+     *
+     * Only the cells around the segment are visited, so a short segment costs the same in a hash of any size.
+     *
+     * @param start The center of the moving circle at the start of the segment.
+     * @param end The center of the moving circle at the end of the segment.
+     * @param radius The radius of the moving circle.
+     * @return True if the distance of a circle from the segment is less than the sum of the radii, or if an end
+     *         of the segment or the radius isn't finite (a diverged state counts as a hit).
+     */
+    bool overlapsSegment(const sf::Vector2f &start, const sf::Vector2f &end, const float radius) const;
+
+    /**
+     * @brief Gets the number of circles in the hash.
+     * @return The number of circles.
+     */
+    size_t size() const { return count; }
+};
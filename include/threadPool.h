@@ -0,0 +1,80 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+
+/**
+ * @class ThreadPool
+ * @brief A fixed set of worker threads which split index ranges between themselves.
+ *
+ * The workers are created once and sleep between jobs, so short jobs don't pay for creating threads.
+ * A job is split into chunks of a given grain size, every thread (including the calling one) claims the next
+ * unprocessed chunk from a shared atomic counter until none are left, so threads which got cheap chunks
+ * automatically take over more of the work.
+ */
+class ThreadPool
+{
+private:
+    std::vector<std::thread> workers; /**< The worker threads, the calling thread works too. */
+
+    std::mutex mutex;                        /**< Guards the job fields and the counters below. */
+    std::condition_variable wakeCondition;   /**< Signalled when a new job is available or the pool stops. */
+    std::condition_variable doneCondition;   /**< Signalled when the last worker finished its part of the job. */
+    std::mutex runMutex;                     /**< Serializes parallelFor() calls from different threads. */
+
+    const std::function<void(size_t, size_t)> *job; /**< The function of the current job. */
+    size_t jobCount;                                /**< The number of indices of the current job. */
+    size_t grainSize;                               /**< The number of indices claimed at once. */
+    std::atomic<size_t> nextIndex;                  /**< The first index not claimed yet. */
+
+    unsigned busyWorkers;     /**< The number of workers still working on the current job. */
+    unsigned long generation; /**< Incremented for every job, wakes the workers. */
+    bool isStopping;          /**< Set by the destructor to stop the workers. */
+
+    /**
+     * @brief Waits for jobs and works on them until the pool is destroyed.
+     */
+    void workerLoop();
+
+    /**
+     * @brief Claims and processes chunks of the current job until none are left.
+     */
+    void runChunks();
+
+public:
+    /**
+     * @brief Constructs a pool and starts its workers.
+     * @param threadCount The number of threads working on a job, including the calling one. 0 means one per core.
+     */
+    explicit ThreadPool(unsigned threadCount = 0);
+
+    /**
+     * @brief Stops and joins the workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /**
+     * @brief Gets the number of threads working on a job.
+     * @return The number of workers plus the calling thread.
+     */
+    unsigned getThreadCount() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    /**
+     * @brief Calls the function for every index in [0, count) split into ranges, and waits until every range is done.
+     *
+     * The function is called from several threads at once with disjoint ranges. It must not throw and must not
+     * call parallelFor() on the same pool.
+     *
+     * @param count The number of indices.
+     * @param grain The maximum number of indices in a range.
+     * @param function Called with the first and one past the last index of a range.
+     */
+    void parallelFor(const size_t count, const size_t grain, const std::function<void(size_t, size_t)> &function);
+};
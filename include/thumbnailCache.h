@@ -0,0 +1,136 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+#include "levelData.h"
+#include "levelManager.h"
+
+/**
+ * @brief A small preview image of a level.
+ */
+struct Thumbnail
+{
+    unsigned width;              /**< The width of the image in pixels. */
+    unsigned height;             /**< The height of the image in pixels. */
+    std::vector<uint8_t> pixels; /**< RGBA pixels row by row from the top, ready for sf::Texture::update(). */
+};
+
+/**
+ * @class ThumbnailCache
+ * @brief Renders the previews of levels on a background thread and keeps them in memory and on disk.
+ *
+ * The menu asks for the preview of every visible level each frame. Previews already rendered are returned at once,
+ * the others are queued for a worker thread, which reads them from levels/thumbnails or renders them from the
+ * level file if the saved one belongs to an older version of the level. No level file is read on the calling thread.
+ */
+class ThumbnailCache
+{
+private:
+    /**
+     * @brief The preview of a level, or a request for it.
+     */
+    struct Entry
+    {
+        uint64_t checksum;                        /**< The checksum of the level file the preview belongs to. */
+        uint64_t journalSize;                     /**< The journal size of the level the preview belongs to. */
+        std::shared_ptr<const Thumbnail> image;   /**< The preview, null until the worker is done. */
+    };
+
+    /**
+     * @brief A preview to be made by the worker.
+     */
+    struct Job
+    {
+        std::string name;     /**< The name of the level. */
+        std::string path;     /**< The path of the level file. */
+        uint64_t checksum;    /**< The checksum of the level file. */
+        uint64_t journalSize; /**< The size of the journal of the level. */
+    };
+
+    std::unordered_map<std::string, Entry> entries; /**< The previews and pending requests by level name. */
+    std::vector<Job> jobs;                          /**< The queued jobs, the latest request is done first. */
+
+    std::mutex mutex;                     /**< Guards the entries, the jobs and the stop flag. */
+    std::condition_variable wakeCondition; /**< Signalled when a job is queued or the cache stops. */
+    std::thread worker;                   /**< Makes the previews, started by the first request. */
+    bool isStopping;                      /**< Set by the destructor to stop the worker. */
+    bool isRendering;                     /**< Set while the worker makes a preview. */
+
+    /**
+     * @brief Makes the queued previews until the cache is destroyed.
+     */
+    void workerLoop();
+
+    /**
+     * @brief Reads a saved preview.
+     * @param job The level the preview has to belong to.
+     * @return The preview, null if there is none or it belongs to another version of the level.
+     */
+    static std::shared_ptr<const Thumbnail> readThumbnail(const Job &job);
+
+    /**
+     * @brief Saves a preview to levels/thumbnails, errors are ignored as the preview can be rendered again.
+     * @param job The level the preview belongs to.
+     * @param image The preview.
+     */
+    static void writeThumbnail(const Job &job, const Thumbnail &image);
+
+public:
+    /**
+     * @brief Constructs an empty cache, the worker is only started when a preview is requested.
+     */
+    ThumbnailCache();
+
+    /**
+     * @brief Stops the worker after its current job and waits for it.
+     */
+    ~ThumbnailCache();
+
+    ThumbnailCache(const ThumbnailCache &) = delete;
+    ThumbnailCache &operator=(const ThumbnailCache &) = delete;
+
+    /**
+     * @brief Gets the preview of a level, queueing it if it isn't ready.
+     * @param info The catalog entry of the level.
+     * @return The preview, null while it is being made or if the level couldn't be read.
+     */
+    std::shared_ptr<const Thumbnail> request(const LevelInfo &info);
+
+    /**
+     * @brief Checks whether the worker has nothing to do.
+     * @return True if no preview is queued or being made.
+     */
+    bool isIdle();
+
+    /**
+     * @brief Drops the preview of a deleted level from memory and disk.
+     * @param levelName The name of the level.
+     */
+    void forget(const std::string &levelName);
+
+    /**
+     * @brief Renders the preview of a level.
+     *
+     * The level is scaled to the image. Every pixel is tinted by the sum of the charges whose collision circle covers it,
+     * red for positive and blue for negative, so the image costs a single pass over the charges.
+     *
+     * @param data The level.
+     * @param width The width of the image in pixels.
+     * @param height The height of the image in pixels.
+     * @return The preview.
+     */
+    static Thumbnail renderThumbnail(const LevelData &data, const unsigned width, const unsigned height);
+
+    /**
+     * @brief Gets the path of the saved preview of a level.
+     * @param levelName The name of the level.
+     * @return The path of the file, relative to the working directory.
+     */
+    static std::string getThumbnailPath(const std::string &levelName);
+};
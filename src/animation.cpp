@@ -1,36 +1,83 @@
 #include <SFML\Graphics.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
 
 #include "animation.h"
+#include "settings.h"
 
-std::shared_ptr<sf::Texture> Animation::playerTexture;
-std::shared_ptr<sf::Texture> Animation::repulseTexture;
-std::shared_ptr<sf::Texture> Animation::attractTexture;
+std::shared_ptr<sf::Texture> Animation::atlas;
+sf::IntRect Animation::playerRect;
+sf::IntRect Animation::repulseRect;
+sf::IntRect Animation::attractRect;
 bool Animation::isLoaded = false;
 
 // Constructs an Animation object.
-// Loads the textures for the player, repulse obstacle, and attract obstacle if they have not been loaded.
+// Loads the texture atlas if it has not been loaded and picks the area of the type of the animation.
 Animation::Animation(const Type type) : type(type)
 {
     if (!isLoaded)
+        loadAtlas();
+    textureRect = getTypeTextureRect(type);
+}
+
+// Load the player, repulse obstacle and attract obstacle textures and copy them into one image next to each other
+void Animation::loadAtlas()
+{
+    sf::Image playerImage;
+    sf::Image repulseImage;
+    sf::Image attractImage;
+    if (!playerImage.loadFromFile("resources/textures/player_texture.png"))
+    {
+        throw std::runtime_error("Failed to load player texture.");
+    }
+    if (!repulseImage.loadFromFile("resources/textures/repulse_obstacle_texture.png"))
+    {
+        throw std::runtime_error("Failed to load repulse texture.");
+    }
+    if (!attractImage.loadFromFile("resources/textures/attract_obstacle_texture.png"))
+    {
+        throw std::runtime_error("Failed to load attract texture.");
+    }
+
+    // Every texture is surrounded by transparent padding
+    const sf::Image *images[] = {&playerImage, &repulseImage, &attractImage};
+    sf::IntRect *rects[] = {&playerRect, &repulseRect, &attractRect};
+    unsigned width = textureAtlasPadding;
+    unsigned height = 0;
+    for (size_t i = 0; i < 3; i++)
+    {
+        const sf::Vector2u size = images[i]->getSize();
+        *rects[i] = sf::IntRect(width, textureAtlasPadding, size.x, size.y);
+        width += size.x + textureAtlasPadding;
+        height = std::max(height, size.y);
+    }
+    height += 2 * textureAtlasPadding;
+
+    sf::Image atlasImage;
+    atlasImage.create(width, height, sf::Color::Transparent);
+    for (size_t i = 0; i < 3; i++)
+        atlasImage.copy(*images[i], rects[i]->left, rects[i]->top);
+
+    atlas = std::make_shared<sf::Texture>();
+    if (!atlas->loadFromImage(atlasImage))
+    {
+        throw std::runtime_error("Failed to create texture atlas.");
+    }
+    atlas->setSmooth(true);
+    isLoaded = true;
+}
+
+// Get the area of a type of animation in the atlas
+const sf::IntRect &Animation::getTypeTextureRect(const Type type)
+{
+    switch (type)
     {
-        playerTexture = std::make_shared<sf::Texture>();
-        repulseTexture = std::make_shared<sf::Texture>();
-        attractTexture = std::make_shared<sf::Texture>();
-        if (!playerTexture->loadFromFile("resources/textures/player_texture.png"))
-        {
-            throw std::runtime_error("Failed to load player texture.");
-        }
-        if (!repulseTexture->loadFromFile("resources/textures/repulse_obstacle_texture.png"))
-        {
-            throw std::runtime_error("Failed to load repulse texture.");
-        }
-        if (!attractTexture->loadFromFile("resources/textures/attract_obstacle_texture.png"))
-        {
-            throw std::runtime_error("Failed to load attract texture.");
-        }
-         playerTexture->setSmooth(true);
-         repulseTexture->setSmooth(true);
-         attractTexture->setSmooth(true);
-        isLoaded = true;
+    case Type::RepulseObstacle:
+        return repulseRect;
+    case Type::AttractObstacle:
+        return attractRect;
+    default:
+        return playerRect;
     }
-}
\ No newline at end of file
+}
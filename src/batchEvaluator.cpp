@@ -0,0 +1,45 @@
+#include <vector>
+#include <algorithm>
+
+#include "batchEvaluator.h"
+#include "physics.h"
+#include "simulationContext.h"
+#include "settings.h"
+
+// Split the players between the threads of the pool in groups advanced in lockstep
+void BatchEvaluator::run(const PhysicsEngine &engine, std::vector<SimulationContext> &simulations, const float timeStep, const unsigned long maxSteps)
+{
+    // Players are handed out in whole groups, so the groups (and the results) don't depend on the number of threads
+    const size_t groupCount = (simulations.size() + simulationLaneCount - 1) / simulationLaneCount;
+    // Several small ranges per thread, so threads which got short trajectories take over the rest
+    const size_t grain = std::max<size_t>(1, groupCount / (pool.getThreadCount() * 8));
+
+    pool.parallelFor(groupCount, grain, [&engine, &simulations, timeStep, maxSteps](const size_t begin, const size_t end)
+                     {
+        for (size_t group = begin; group < end; group++)
+        {
+            const size_t first = group * simulationLaneCount;
+            const size_t count = std::min(simulationLaneCount, simulations.size() - first);
+
+            // Simulate local copies, so neighbouring contexts written by other threads don't share cache lines
+            SimulationContext local[simulationLaneCount];
+            std::copy(simulations.begin() + first, simulations.begin() + first + count, local);
+
+            // Finished players drop out of the group, the rest keep sharing the obstacle loads
+            SimulationContext *active[simulationLaneCount];
+            size_t activeCount = 0;
+            for (size_t i = 0; i < count; i++)
+                if (!local[i].isHit && local[i].steps < maxSteps)
+                    active[activeCount++] = &local[i];
+
+            while (activeCount != 0)
+            {
+                engine.advanceLanes(active, activeCount, timeStep);
+                activeCount = std::remove_if(active, active + activeCount, [maxSteps](const SimulationContext *simulation)
+                                             { return simulation->isHit || simulation->steps >= maxSteps; }) -
+                              active;
+            }
+
+            std::copy(local, local + count, simulations.begin() + first);
+        } });
+}
@@ -0,0 +1,321 @@
+#include <SFML\System.hpp>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "chargeQuadtree.h"
+#include "forceKernel.h"
+
+// Add the field of a point charge at (chargeX, chargeY) to the field at pos
+static void addMonopoleField(sf::Vector2f &field, const float charge, const float chargeX, const float chargeY, const sf::Vector2f &pos)
+{
+    const float riX = chargeX - pos.x;
+    const float riY = chargeY - pos.y;
+    const float riLengthSquared = riX * riX + riY * riY;
+    const float factor = charge / (riLengthSquared * std::sqrt(riLengthSquared));
+    field.x += factor * riX;
+    field.y += factor * riY;
+}
+
+// Build tree from charge store, root cell covers the level and every charge
+void ChargeQuadtree::build(const ChargeStore &charges, const sf::Vector2u &bounds)
+{
+    clear();
+
+    // Calculate bounding box of level and charges
+    float minX = 0.0f, minY = 0.0f;
+    float maxX = bounds.x, maxY = bounds.y;
+    for (size_t i = 0; i < charges.size(); i++)
+    {
+        minX = std::min(minX, charges.getX()[i]);
+        minY = std::min(minY, charges.getY()[i]);
+        maxX = std::max(maxX, charges.getX()[i]);
+        maxY = std::max(maxY, charges.getY()[i]);
+    }
+
+    // Root is a square, slightly bigger than the bounding box so charges on the edges are inside
+    Node root;
+    root.centerX = (minX + maxX) / 2.0f;
+    root.centerY = (minY + maxY) / 2.0f;
+    root.halfSize = std::max(1.0f, std::max(maxX - minX, maxY - minY) / 2.0f + 1.0f);
+    nodes.push_back(root);
+
+    std::vector<size_t> indices(charges.size());
+    for (size_t i = 0; i < indices.size(); i++)
+        indices[i] = i;
+
+    build(0, charges, indices, 0);
+}
+
+// Split node into four children until cells contain few enough charges
+void ChargeQuadtree::build(const size_t nodeIdx, const ChargeStore &charges, std::vector<size_t> &indices, const unsigned depth)
+{
+    nodes[nodeIdx].firstChild = -1;
+    nodes[nodeIdx].bucket = -1;
+
+    // Small enough cells become leaves, the charges are copied to their bucket
+    if (indices.size() <= leafCapacity || depth >= maxDepth)
+    {
+        Bucket bucket;
+        bucket.x.reserve(indices.size());
+        bucket.y.reserve(indices.size());
+        bucket.q.reserve(indices.size());
+        for (const size_t i : indices)
+        {
+            bucket.x.push_back(charges.getX()[i]);
+            bucket.y.push_back(charges.getY()[i]);
+            bucket.q.push_back(charges.getCharge()[i]);
+        }
+        nodes[nodeIdx].bucket = buckets.size();
+        buckets.push_back(std::move(bucket));
+        updateMoments(nodeIdx);
+        return;
+    }
+
+    // Sort charges into quadrants: index is (right ? 1 : 0) + (bottom ? 2 : 0)
+    const float centerX = nodes[nodeIdx].centerX;
+    const float centerY = nodes[nodeIdx].centerY;
+    const float childHalfSize = nodes[nodeIdx].halfSize / 2.0f;
+    std::vector<size_t> quadrants[4];
+    for (const size_t i : indices)
+        quadrants[(charges.getX()[i] >= centerX ? 1 : 0) + (charges.getY()[i] >= centerY ? 2 : 0)].push_back(i);
+    // Indices of this node are not needed anymore, free them before going deeper
+    std::vector<size_t>().swap(indices);
+
+    // Create children, nodes can be reallocated so only indices are used from here
+    const int firstChild = nodes.size();
+    nodes[nodeIdx].firstChild = firstChild;
+    for (int quadrant = 0; quadrant < 4; quadrant++)
+    {
+        Node child;
+        child.centerX = centerX + (quadrant & 1 ? childHalfSize : -childHalfSize);
+        child.centerY = centerY + (quadrant & 2 ? childHalfSize : -childHalfSize);
+        child.halfSize = childHalfSize;
+        nodes.push_back(child);
+    }
+    for (int quadrant = 0; quadrant < 4; quadrant++)
+        build(firstChild + quadrant, charges, quadrants[quadrant], depth + 1);
+
+    updateMoments(nodeIdx);
+}
+
+// Sum charges and centres of charge of a node, separately for both signs
+void ChargeQuadtree::updateMoments(const size_t nodeIdx)
+{
+    Node &node = nodes[nodeIdx];
+    float positiveCharge = 0.0f, positiveX = 0.0f, positiveY = 0.0f;
+    float negativeCharge = 0.0f, negativeX = 0.0f, negativeY = 0.0f;
+
+    if (node.bucket >= 0)
+    {
+        // Leaf: moments of the charges in the bucket
+        const Bucket &bucket = buckets[node.bucket];
+        for (size_t i = 0; i < bucket.q.size(); i++)
+        {
+            if (bucket.q[i] > 0.0f)
+            {
+                positiveCharge += bucket.q[i];
+                positiveX += bucket.q[i] * bucket.x[i];
+                positiveY += bucket.q[i] * bucket.y[i];
+            }
+            else
+            {
+                negativeCharge += bucket.q[i];
+                negativeX += bucket.q[i] * bucket.x[i];
+                negativeY += bucket.q[i] * bucket.y[i];
+            }
+        }
+    }
+    else
+    {
+        // Inner node: moments of the children
+        for (int child = node.firstChild; child < node.firstChild + 4; child++)
+        {
+            positiveCharge += nodes[child].positiveCharge;
+            positiveX += nodes[child].positiveCharge * nodes[child].positiveX;
+            positiveY += nodes[child].positiveCharge * nodes[child].positiveY;
+            negativeCharge += nodes[child].negativeCharge;
+            negativeX += nodes[child].negativeCharge * nodes[child].negativeX;
+            negativeY += nodes[child].negativeCharge * nodes[child].negativeY;
+        }
+    }
+
+    // Centres of charge, cells without charges of a sign use the centre of the cell
+    node.positiveCharge = positiveCharge;
+    node.positiveX = positiveCharge != 0.0f ? positiveX / positiveCharge : node.centerX;
+    node.positiveY = positiveCharge != 0.0f ? positiveY / positiveCharge : node.centerY;
+    node.negativeCharge = negativeCharge;
+    node.negativeX = negativeCharge != 0.0f ? negativeX / negativeCharge : node.centerX;
+    node.negativeY = negativeCharge != 0.0f ? negativeY / negativeCharge : node.centerY;
+}
+
+// Remove every node and bucket
+void ChargeQuadtree::clear()
+{
+    nodes.clear();
+    buckets.clear();
+}
+
+// Descend from the root to the leaf containing the position
+bool ChargeQuadtree::findLeaf(const float posX, const float posY, std::vector<size_t> &path) const
+{
+    if (nodes.empty())
+        return false;
+
+    // Same containment rule as when building: the lower edges belong to the cell
+    const Node &root = nodes[0];
+    if (posX < root.centerX - root.halfSize || posX >= root.centerX + root.halfSize ||
+        posY < root.centerY - root.halfSize || posY >= root.centerY + root.halfSize)
+        return false;
+
+    size_t nodeIdx = 0;
+    path.push_back(nodeIdx);
+    while (nodes[nodeIdx].bucket < 0)
+    {
+        const Node &node = nodes[nodeIdx];
+        nodeIdx = node.firstChild + (posX >= node.centerX ? 1 : 0) + (posY >= node.centerY ? 2 : 0);
+        path.push_back(nodeIdx);
+    }
+    return true;
+}
+
+// Split full leaf, its bucket is reused by the first child
+void ChargeQuadtree::split(const size_t nodeIdx)
+{
+    Bucket charges = std::move(buckets[nodes[nodeIdx].bucket]);
+    const int reusedBucket = nodes[nodeIdx].bucket;
+    buckets[reusedBucket] = Bucket();
+
+    const float centerX = nodes[nodeIdx].centerX;
+    const float centerY = nodes[nodeIdx].centerY;
+    const float childHalfSize = nodes[nodeIdx].halfSize / 2.0f;
+    const int firstChild = nodes.size();
+    nodes[nodeIdx].firstChild = firstChild;
+    nodes[nodeIdx].bucket = -1;
+
+    // Create four empty leaves
+    for (int quadrant = 0; quadrant < 4; quadrant++)
+    {
+        Node child;
+        child.centerX = centerX + (quadrant & 1 ? childHalfSize : -childHalfSize);
+        child.centerY = centerY + (quadrant & 2 ? childHalfSize : -childHalfSize);
+        child.halfSize = childHalfSize;
+        child.firstChild = -1;
+        child.bucket = quadrant == 0 ? reusedBucket : static_cast<int>(buckets.size());
+        if (quadrant != 0)
+            buckets.push_back(Bucket());
+        nodes.push_back(child);
+    }
+
+    // Distribute charges between the children
+    for (size_t i = 0; i < charges.q.size(); i++)
+    {
+        const int quadrant = (charges.x[i] >= centerX ? 1 : 0) + (charges.y[i] >= centerY ? 2 : 0);
+        Bucket &bucket = buckets[nodes[firstChild + quadrant].bucket];
+        bucket.x.push_back(charges.x[i]);
+        bucket.y.push_back(charges.y[i]);
+        bucket.q.push_back(charges.q[i]);
+    }
+    for (int quadrant = 0; quadrant < 4; quadrant++)
+        updateMoments(firstChild + quadrant);
+}
+
+// Insert charge into its leaf and update moments up to the root
+bool ChargeQuadtree::insert(const float posX, const float posY, const float charge)
+{
+    std::vector<size_t> path;
+    if (!findLeaf(posX, posY, path))
+        return false;
+
+    const size_t leafIdx = path.back();
+    Bucket &bucket = buckets[nodes[leafIdx].bucket];
+    bucket.x.push_back(posX);
+    bucket.y.push_back(posY);
+    bucket.q.push_back(charge);
+
+    // Leaf depth is the length of the path without the root
+    if (bucket.q.size() > leafCapacity && path.size() - 1 < maxDepth)
+        split(leafIdx);
+
+    for (auto it = path.rbegin(); it != path.rend(); it++)
+        updateMoments(*it);
+    return true;
+}
+
+// Remove charge from its leaf and update moments up to the root
+bool ChargeQuadtree::remove(const float posX, const float posY, const float charge)
+{
+    std::vector<size_t> path;
+    if (!findLeaf(posX, posY, path))
+        return false;
+
+    // Look for the charge in the bucket, swap it with the last one and pop it
+    Bucket &bucket = buckets[nodes[path.back()].bucket];
+    for (size_t i = 0; i < bucket.q.size(); i++)
+    {
+        if (bucket.x[i] == posX && bucket.y[i] == posY && bucket.q[i] == charge)
+        {
+            bucket.x[i] = bucket.x.back();
+            bucket.y[i] = bucket.y.back();
+            bucket.q[i] = bucket.q.back();
+            bucket.x.pop_back();
+            bucket.y.pop_back();
+            bucket.q.pop_back();
+
+            for (auto it = path.rbegin(); it != path.rend(); it++)
+                updateMoments(*it);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Walk the tree, opening cells that are too close for the monopole approximation
+sf::Vector2f ChargeQuadtree::evaluate(const sf::Vector2f &pos, const float openingAngle, const ForceKernel kernel) const
+{
+    sf::Vector2f field(0.0f, 0.0f);
+    if (nodes.empty())
+        return field;
+
+    // Explicit stack, at most 3 siblings are waiting on every level of the tree
+    int stack[3 * maxDepth + 4];
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    const float openingAngleSquared = openingAngle * openingAngle;
+    while (stackSize > 0)
+    {
+        const Node &node = nodes[stack[--stackSize]];
+
+        // Skip cells without charges
+        if (node.positiveCharge == 0.0f && node.negativeCharge == 0.0f)
+            continue;
+
+        // Leaves are summed exactly
+        if (node.bucket >= 0)
+        {
+            const Bucket &bucket = buckets[node.bucket];
+            field += sumElectricField(bucket.x.data(), bucket.y.data(), bucket.q.data(), bucket.q.size(), pos, kernel);
+            continue;
+        }
+
+        // Open cell if pos is inside it or if it is too big compared to its distance: size / distance >= theta
+        const float riX = node.centerX - pos.x;
+        const float riY = node.centerY - pos.y;
+        const float size = 2.0f * node.halfSize;
+        const bool isInside = std::abs(riX) <= node.halfSize && std::abs(riY) <= node.halfSize;
+        if (isInside || size * size >= openingAngleSquared * (riX * riX + riY * riY))
+        {
+            for (int child = node.firstChild; child < node.firstChild + 4; child++)
+                stack[stackSize++] = child;
+            continue;
+        }
+
+        // Far enough: the cell acts like its two monopoles
+        if (node.positiveCharge != 0.0f)
+            addMonopoleField(field, node.positiveCharge, node.positiveX, node.positiveY, pos);
+        if (node.negativeCharge != 0.0f)
+            addMonopoleField(field, node.negativeCharge, node.negativeX, node.negativeY, pos);
+    }
+    return field;
+}
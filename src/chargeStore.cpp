@@ -0,0 +1,248 @@
+#include <vector>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <atomic>
+
+#include "chargeStore.h"
+#include "settings.h"
+
+extern const size_t maxChargeDeltas;
+
+std::atomic<unsigned long> ChargeStore::revisionCounter(0);
+
+ChargeStore::ChargeStore()
+    : revision(revisionCounter.fetch_add(1) + 1), deltaBaseRevision(revision)
+{
+    updateViews();
+}
+
+// Copy owned arrays, share viewed ones
+ChargeStore::ChargeStore(const ChargeStore &other)
+    : x(other.x), y(other.y), q(other.q), collisionRadius(other.collisionRadius), external(other.external),
+      revision(other.revision), deltas(other.deltas), deltaBaseRevision(other.deltaBaseRevision)
+{
+    if (external)
+    {
+        viewX = other.viewX;
+        viewY = other.viewY;
+        viewQ = other.viewQ;
+        viewCollisionRadius = other.viewCollisionRadius;
+        count = other.count;
+    }
+    else
+        updateViews();
+}
+
+// Copy owned arrays, share viewed ones
+ChargeStore &ChargeStore::operator=(const ChargeStore &other)
+{
+    if (this == &other)
+        return *this;
+
+    x = other.x;
+    y = other.y;
+    q = other.q;
+    collisionRadius = other.collisionRadius;
+    external = other.external;
+    revision = other.revision;
+    deltas = other.deltas;
+    deltaBaseRevision = other.deltaBaseRevision;
+    if (external)
+    {
+        viewX = other.viewX;
+        viewY = other.viewY;
+        viewQ = other.viewQ;
+        viewCollisionRadius = other.viewCollisionRadius;
+        count = other.count;
+    }
+    else
+        updateViews();
+    return *this;
+}
+
+// Steal arrays, views stay valid as moving a vector keeps its memory
+ChargeStore::ChargeStore(ChargeStore &&other) noexcept
+    : x(std::move(other.x)), y(std::move(other.y)), q(std::move(other.q)), collisionRadius(std::move(other.collisionRadius)),
+      external(std::move(other.external)), viewX(other.viewX), viewY(other.viewY), viewQ(other.viewQ),
+      viewCollisionRadius(other.viewCollisionRadius), count(other.count),
+      revision(other.revision), deltas(std::move(other.deltas)), deltaBaseRevision(other.deltaBaseRevision)
+{
+    other.clear();
+}
+
+// Steal arrays, views stay valid as moving a vector keeps its memory
+ChargeStore &ChargeStore::operator=(ChargeStore &&other) noexcept
+{
+    if (this == &other)
+        return *this;
+
+    x = std::move(other.x);
+    y = std::move(other.y);
+    q = std::move(other.q);
+    collisionRadius = std::move(other.collisionRadius);
+    external = std::move(other.external);
+    viewX = other.viewX;
+    viewY = other.viewY;
+    viewQ = other.viewQ;
+    viewCollisionRadius = other.viewCollisionRadius;
+    count = other.count;
+    revision = other.revision;
+    deltas = std::move(other.deltas);
+    deltaBaseRevision = other.deltaBaseRevision;
+    other.clear();
+    return *this;
+}
+
+// Use arrays owned by someone else until the first edit
+void ChargeStore::view(const std::shared_ptr<const void> &owner, const size_t chargeCount,
+                       const float *posX, const float *posY, const float *charge, const float *radius)
+{
+    clear();
+    external = owner;
+    viewX = posX;
+    viewY = posY;
+    viewQ = charge;
+    viewCollisionRadius = radius;
+    count = chargeCount;
+}
+
+// Copy viewed arrays before the first edit
+void ChargeStore::detach()
+{
+    if (!external)
+        return;
+
+    x.assign(viewX, viewX + count);
+    y.assign(viewY, viewY + count);
+    q.assign(viewQ, viewQ + count);
+    collisionRadius.assign(viewCollisionRadius, viewCollisionRadius + count);
+    external.reset();
+    updateViews();
+}
+
+// Views follow the owned arrays, whose memory may have moved
+void ChargeStore::updateViews()
+{
+    viewX = x.data();
+    viewY = y.data();
+    viewQ = q.data();
+    viewCollisionRadius = collisionRadius.data();
+    count = q.size();
+}
+
+// Append the charge to the end of every array
+void ChargeStore::add(const float posX, const float posY, const float charge, const float radius)
+{
+    detach();
+    x.push_back(posX);
+    y.push_back(posY);
+    q.push_back(charge);
+    collisionRadius.push_back(radius);
+    updateViews();
+    recordDelta(ChargeDelta::Type::Add, q.size() - 1);
+}
+
+// Erase the charge from every array, order is kept to stay in sync with the obstacles of the level
+void ChargeStore::remove(const size_t idx)
+{
+    detach();
+    recordDelta(ChargeDelta::Type::Remove, idx);
+    x.erase(x.begin() + idx);
+    y.erase(y.begin() + idx);
+    q.erase(q.begin() + idx);
+    collisionRadius.erase(collisionRadius.begin() + idx);
+    updateViews();
+}
+
+// Move the last charge into the place of the removed one, the other charges keep their index
+void ChargeStore::swapRemove(const size_t idx)
+{
+    detach();
+    recordDelta(ChargeDelta::Type::SwapRemove, idx);
+    x[idx] = x.back();
+    y[idx] = y.back();
+    q[idx] = q.back();
+    collisionRadius[idx] = collisionRadius.back();
+    x.pop_back();
+    y.pop_back();
+    q.pop_back();
+    collisionRadius.pop_back();
+    updateViews();
+}
+
+// Clear every array, viewed arrays are released
+void ChargeStore::clear()
+{
+    x.clear();
+    y.clear();
+    q.clear();
+    collisionRadius.clear();
+    external.reset();
+    updateViews();
+
+    // Consumers have to rebuild
+    revision = revisionCounter.fetch_add(1) + 1;
+    deltas.clear();
+    deltaBaseRevision = revision;
+}
+
+// Reserve memory in every array
+void ChargeStore::reserve(const size_t reserved)
+{
+    detach();
+    x.reserve(reserved);
+    y.reserve(reserved);
+    q.reserve(reserved);
+    collisionRadius.reserve(reserved);
+    updateViews();
+}
+
+// Bump revision and append edit to delta log
+void ChargeStore::recordDelta(const ChargeDelta::Type type, const size_t idx)
+{
+    revision = revisionCounter.fetch_add(1) + 1;
+
+    // If the log is full, drop the older half, consumers which are that far behind have to rebuild
+    if (deltas.size() >= maxChargeDeltas)
+    {
+        const size_t dropCount = deltas.size() / 2 + 1;
+        deltaBaseRevision = deltas[dropCount - 1].revision;
+        deltas.erase(deltas.begin(), deltas.begin() + dropCount);
+    }
+
+    ChargeDelta delta;
+    delta.type = type;
+    delta.x = x[idx];
+    delta.y = y[idx];
+    delta.q = q[idx];
+    delta.collisionRadius = collisionRadius[idx];
+    delta.index = idx;
+    delta.revision = revision;
+    deltas.push_back(delta);
+}
+
+// Collect edits made after the given revision
+bool ChargeStore::getDeltasSince(const unsigned long sinceRevision, std::vector<ChargeDelta> &result) const
+{
+    if (sinceRevision == revision)
+        return true;
+
+    // Find the edit which brought the store to sinceRevision, the edits after it are needed
+    size_t first;
+    if (sinceRevision == deltaBaseRevision)
+        first = 0;
+    else
+    {
+        auto it = std::lower_bound(deltas.begin(), deltas.end(), sinceRevision,
+                                   [](const ChargeDelta &delta, const unsigned long rev)
+                                   { return delta.revision < rev; });
+        // Revision is not in the log (too old, or from another store)
+        if (it == deltas.end() || it->revision != sinceRevision)
+            return false;
+        first = it - deltas.begin() + 1;
+    }
+
+    result.insert(result.end(), deltas.begin() + first, deltas.end());
+    return true;
+}
@@ -0,0 +1,153 @@
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "compression.h"
+
+namespace
+{
+    const size_t minMatch = 4;          // Shorter copies would cost more than the literals
+    const size_t maxOffset = 65535;     // Offsets are stored in 2 bytes
+    const unsigned hashBits = 16;       // The match finder remembers the last position of 2^16 hashed 4 byte sequences
+
+    // Hash of the 4 bytes at the position
+    uint32_t hashSequence(const unsigned char *p)
+    {
+        uint32_t sequence;
+        std::memcpy(&sequence, p, sizeof(sequence));
+        return (sequence * 2654435761u) >> (32 - hashBits);
+    }
+
+    // Lengths of 15 and more continue in extra bytes, each adding up to 255
+    void writeLength(std::vector<unsigned char> &out, size_t length)
+    {
+        while (length >= 255)
+        {
+            out.push_back(255);
+            length -= 255;
+        }
+        out.push_back(static_cast<unsigned char>(length));
+    }
+
+    // Write the literals and the copy of one block, the token holds the short lengths
+    void writeBlock(std::vector<unsigned char> &out, const unsigned char *literals, const size_t literalCount, const size_t offset, const size_t matchLength)
+    {
+        const size_t matchCode = matchLength == 0 ? 0 : matchLength - minMatch;
+        out.push_back(static_cast<unsigned char>((std::min<size_t>(literalCount, 15) << 4) | std::min<size_t>(matchCode, 15)));
+        if (literalCount >= 15)
+            writeLength(out, literalCount - 15);
+        out.insert(out.end(), literals, literals + literalCount);
+        if (matchLength == 0)
+            return;
+        out.push_back(static_cast<unsigned char>(offset & 0xFF));
+        out.push_back(static_cast<unsigned char>(offset >> 8));
+        if (matchCode >= 15)
+            writeLength(out, matchCode - 15);
+    }
+
+    // Read an extended length, checking the end of the input
+    size_t readLength(const unsigned char *&in, const unsigned char *end)
+    {
+        size_t length = 0;
+        unsigned char byte;
+        do
+        {
+            if (in == end)
+                throw std::runtime_error("Compression: Truncated length");
+            byte = *in++;
+            length += byte;
+        } while (byte == 255);
+        return length;
+    }
+}
+
+// Greedy LZ77, the last block only holds literals
+std::vector<unsigned char> compressBytes(const unsigned char *data, const size_t size)
+{
+    std::vector<unsigned char> out;
+    out.reserve(size / 2 + 16);
+    std::vector<size_t> lastPosition(size_t(1) << hashBits, SIZE_MAX);
+
+    size_t literalStart = 0;
+    size_t pos = 0;
+    while (size >= minMatch && pos <= size - minMatch)
+    {
+        const uint32_t hash = hashSequence(data + pos);
+        const size_t candidate = lastPosition[hash];
+        lastPosition[hash] = pos;
+        if (candidate == SIZE_MAX || pos - candidate > maxOffset || std::memcmp(data + candidate, data + pos, minMatch) != 0)
+        {
+            pos++;
+            continue;
+        }
+
+        // Extend the match as far as the input allows, it may overlap the bytes being encoded
+        size_t length = minMatch;
+        while (pos + length < size && data[candidate + length] == data[pos + length])
+            length++;
+        writeBlock(out, data + literalStart, pos - literalStart, pos - candidate, length);
+
+        // Remember a few positions inside the match, so the next repetition is found too
+        const size_t end = pos + length;
+        for (size_t i = pos + 1; i < end && i + minMatch <= size; i += 1 + (length >> 4))
+            lastPosition[hashSequence(data + i)] = i;
+        pos = end;
+        literalStart = pos;
+    }
+    writeBlock(out, data + literalStart, size - literalStart, 0, 0);
+    return out;
+}
+
+// Copy literals and earlier output block by block, every length and offset is checked before it is used
+void decompressBytes(const unsigned char *compressed, const size_t compressedSize, unsigned char *output, const size_t size)
+{
+    const unsigned char *in = compressed;
+    const unsigned char *const inEnd = compressed + compressedSize;
+    unsigned char *out = output;
+    unsigned char *const outEnd = output + size;
+
+    while (true)
+    {
+        if (in == inEnd)
+            throw std::runtime_error("Compression: Truncated block");
+        const unsigned char token = *in++;
+
+        size_t literalCount = token >> 4;
+        if (literalCount == 15)
+            literalCount += readLength(in, inEnd);
+        if (literalCount > static_cast<size_t>(inEnd - in) || literalCount > static_cast<size_t>(outEnd - out))
+            throw std::runtime_error("Compression: Corrupt literals");
+        std::memcpy(out, in, literalCount);
+        in += literalCount;
+        out += literalCount;
+
+        // The last block has no copy
+        if (in == inEnd)
+            break;
+
+        if (inEnd - in < 2)
+            throw std::runtime_error("Compression: Truncated offset");
+        const size_t offset = in[0] | (static_cast<size_t>(in[1]) << 8);
+        in += 2;
+        size_t length = (token & 0x0F) + minMatch;
+        if ((token & 0x0F) == 15)
+            length += readLength(in, inEnd);
+        if (offset == 0 || offset > static_cast<size_t>(out - output) || length > static_cast<size_t>(outEnd - out))
+            throw std::runtime_error("Compression: Corrupt copy");
+
+        // Overlapping copies repeat the last offset bytes, they have to go byte by byte
+        const unsigned char *from = out - offset;
+        if (offset >= length)
+            std::memcpy(out, from, length);
+        else
+            for (size_t i = 0; i < length; i++)
+                out[i] = from[i];
+        out += length;
+    }
+
+    if (out != outEnd)
+        throw std::runtime_error("Compression: Decompressed size mismatch");
+}
@@ -0,0 +1,145 @@
+#include <SFML\System.hpp>
+#include <vector>
+#include <thread>
+#include <cmath>
+#include <algorithm>
+
+#include "fieldGrid.h"
+#include "forceKernel.h"
+
+// Catmull-Rom weights of the 4 nodes around a point t in [0, 1] between the middle two
+static void getCubicWeights(const float t, float weights[4])
+{
+    const float t2 = t * t;
+    const float t3 = t2 * t;
+    weights[0] = (-t3 + 2.0f * t2 - t) / 2.0f;
+    weights[1] = (3.0f * t3 - 5.0f * t2 + 2.0f) / 2.0f;
+    weights[2] = (-3.0f * t3 + 4.0f * t2 + t) / 2.0f;
+    weights[3] = (t3 - t2) / 2.0f;
+}
+
+// Empty grid
+FieldGrid::FieldGrid()
+    : cellSize(1.0f), columns(0), rows(0)
+{
+}
+
+// Index of node, out of bounds nodes are clamped to the edge
+size_t FieldGrid::getNodeIndex(int column, int row) const
+{
+    column = std::max(0, std::min(column, static_cast<int>(columns) - 1));
+    row = std::max(0, std::min(row, static_cast<int>(rows) - 1));
+    return static_cast<size_t>(row) * columns + column;
+}
+
+// Sum field of every charge at every node
+void FieldGrid::bake(const ChargeStore &charges, const sf::Vector2u &size, const float newCellSize, const ForceKernel kernel, const unsigned threadCount)
+{
+    // Nodes are on the corners of the cells, so the last row and column lie on the edge of the level
+    cellSize = newCellSize;
+    columns = static_cast<unsigned>(std::ceil(size.x / cellSize)) + 1;
+    rows = static_cast<unsigned>(std::ceil(size.y / cellSize)) + 1;
+    fieldX.assign(static_cast<size_t>(columns) * rows, 0.0f);
+    fieldY.assign(static_cast<size_t>(columns) * rows, 0.0f);
+
+    // Every thread calculates an interleaved set of rows, so the work is even if charges are clustered
+    auto bakeRows = [this, &charges, kernel](const unsigned firstRow, const unsigned rowStep)
+    {
+        for (unsigned row = firstRow; row < rows; row += rowStep)
+        {
+            for (unsigned column = 0; column < columns; column++)
+            {
+                const sf::Vector2f nodePos(column * cellSize, row * cellSize);
+                sf::Vector2f field = sumElectricField(charges.getX(), charges.getY(), charges.getCharge(), charges.size(), nodePos, kernel);
+                // Nodes on top of a charge would be infinite
+                if (!std::isfinite(field.x) || !std::isfinite(field.y))
+                    field = sf::Vector2f(0.0f, 0.0f);
+                fieldX[static_cast<size_t>(row) * columns + column] = field.x;
+                fieldY[static_cast<size_t>(row) * columns + column] = field.y;
+            }
+        }
+    };
+
+    const unsigned workerCount = std::max(1u, std::min(threadCount, rows));
+    std::vector<std::thread> workers;
+    for (unsigned worker = 1; worker < workerCount; worker++)
+        workers.emplace_back(bakeRows, worker, workerCount);
+    // Calling thread does its share too
+    bakeRows(0, workerCount);
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+// Add field of one charge to every node
+void FieldGrid::addCharge(const float posX, const float posY, const float charge)
+{
+    for (unsigned row = 0; row < rows; row++)
+    {
+        for (unsigned column = 0; column < columns; column++)
+        {
+            const float riX = posX - column * cellSize;
+            const float riY = posY - row * cellSize;
+            const float riLengthSquared = riX * riX + riY * riY;
+            // Nodes on top of the charge are left alone, same as when baking
+            if (riLengthSquared == 0.0f)
+                continue;
+            const float factor = charge / (riLengthSquared * std::sqrt(riLengthSquared));
+            fieldX[static_cast<size_t>(row) * columns + column] += factor * riX;
+            fieldY[static_cast<size_t>(row) * columns + column] += factor * riY;
+        }
+    }
+}
+
+// Interpolate field between nodes
+sf::Vector2f FieldGrid::sample(const sf::Vector2f &pos, const Interpolation interpolation) const
+{
+    if (!isBaked())
+        return sf::Vector2f(0.0f, 0.0f);
+
+    // Position in grid coordinates, clamped to the grid
+    const float gridX = std::max(0.0f, std::min(pos.x / cellSize, static_cast<float>(columns - 1)));
+    const float gridY = std::max(0.0f, std::min(pos.y / cellSize, static_cast<float>(rows - 1)));
+    const int column = std::min(static_cast<int>(gridX), std::max(0, static_cast<int>(columns) - 2));
+    const int row = std::min(static_cast<int>(gridY), std::max(0, static_cast<int>(rows) - 2));
+    const float tX = gridX - column;
+    const float tY = gridY - row;
+
+    sf::Vector2f field(0.0f, 0.0f);
+    if (interpolation == Interpolation::Bicubic)
+    {
+        // Weighted sum of the 4x4 surrounding nodes
+        float weightsX[4], weightsY[4];
+        getCubicWeights(tX, weightsX);
+        getCubicWeights(tY, weightsY);
+        for (int j = 0; j < 4; j++)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                const size_t idx = getNodeIndex(column - 1 + i, row - 1 + j);
+                const float weight = weightsX[i] * weightsY[j];
+                field.x += weight * fieldX[idx];
+                field.y += weight * fieldY[idx];
+            }
+        }
+    }
+    else
+    {
+        // Weighted sum of the 4 surrounding nodes
+        const size_t topLeft = getNodeIndex(column, row);
+        const size_t topRight = getNodeIndex(column + 1, row);
+        const size_t bottomLeft = getNodeIndex(column, row + 1);
+        const size_t bottomRight = getNodeIndex(column + 1, row + 1);
+        field.x = (1.0f - tY) * ((1.0f - tX) * fieldX[topLeft] + tX * fieldX[topRight]) + tY * ((1.0f - tX) * fieldX[bottomLeft] + tX * fieldX[bottomRight]);
+        field.y = (1.0f - tY) * ((1.0f - tX) * fieldY[topLeft] + tX * fieldY[topRight]) + tY * ((1.0f - tX) * fieldY[bottomLeft] + tX * fieldY[bottomRight]);
+    }
+    return field;
+}
+
+// Remove every node
+void FieldGrid::clear()
+{
+    columns = 0;
+    rows = 0;
+    fieldX.clear();
+    fieldY.clear();
+}
@@ -0,0 +1,166 @@
+#include <SFML\Graphics.hpp>
+#include <vector>
+#include <memory>
+#include <future>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "fieldLineTracer.h"
+#include "forceKernel.h"
+#include "threadPool.h"
+#include "settings.h"
+
+extern const char debug;
+
+// Empty tracer, the widest kernel of the CPU is used
+FieldLineTracer::FieldLineTracer()
+    : kernel(detectForceKernel()), lines(sf::Lines), jobRevision(0), jobSize(0, 0), tracedRevision(0), tracedSize(0, 0)
+{
+}
+
+// The pool must outlive the job
+FieldLineTracer::~FieldLineTracer()
+{
+    if (job.valid())
+        job.wait();
+}
+
+// Take finished lines, then start a trace if they are outdated and none is running
+void FieldLineTracer::update(const ChargeStore &charges, const sf::Vector2u &size)
+{
+    if (job.valid() && job.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        wait();
+
+    if (job.valid() || (charges.getRevision() == tracedRevision && size == tracedSize))
+        return;
+
+    if (!pool)
+        pool = std::make_unique<ThreadPool>();
+    jobRevision = charges.getRevision();
+    jobSize = size;
+
+    // The job keeps its copy until the next update, which doesn't come while a menu is open, so it must not hold the mapped level file
+    ChargeStore jobCharges(charges);
+    jobCharges.detach();
+    job = std::async(std::launch::async, [this, jobCharges = std::move(jobCharges), size]()
+                     { return trace(jobCharges, size); });
+}
+
+// Replace the cached lines with the ones of the job
+void FieldLineTracer::wait()
+{
+    if (!job.valid())
+        return;
+    lines = job.get();
+    tracedRevision = jobRevision;
+    tracedSize = jobSize;
+}
+
+// Seed lines evenly around every n-th charge, trace them in parallel and join them into one vertex array
+sf::VertexArray FieldLineTracer::trace(const ChargeStore &charges, const sf::Vector2u &size) const
+{
+    const size_t seedChargeLimit = std::max<size_t>(1, fieldLineMaxLines / fieldLinesPerCharge);
+    const size_t stride = std::max<size_t>(1, (charges.size() + seedChargeLimit - 1) / seedChargeLimit);
+    const size_t seedCharges = (charges.size() + stride - 1) / stride;
+    const size_t lineCount = seedCharges * fieldLinesPerCharge;
+
+    const float *x = charges.getX();
+    const float *y = charges.getY();
+    const float *q = charges.getCharge();
+    const float *r = charges.getCollisionRadius();
+
+    std::vector<std::vector<sf::Vector2f>> linePoints(lineCount);
+    pool->parallelFor(lineCount, 1, [&](const size_t begin, const size_t end)
+                      {
+                          for (size_t line = begin; line < end; line++)
+                          {
+                              const size_t charge = (line / fieldLinesPerCharge) * stride;
+                              if (q[charge] == 0.0f)
+                                  continue;
+                              const float angle = 2.0f * static_cast<float>(M_PI) * (line % fieldLinesPerCharge) / fieldLinesPerCharge;
+                              const float startRadius = r[charge] + 1.0f;
+                              const sf::Vector2f start(x[charge] + startRadius * std::cos(angle), y[charge] + startRadius * std::sin(angle));
+                              traceLine(charges, size, start, q[charge] > 0.0f ? 1.0f : -1.0f, linePoints[line]);
+                          }
+                      });
+
+    // Every segment is its own pair of vertices, so all lines are a single draw call
+    size_t segmentCount = 0;
+    for (const std::vector<sf::Vector2f> &points : linePoints)
+        segmentCount += points.empty() ? 0 : points.size() - 1;
+    sf::VertexArray segments(sf::Lines, segmentCount * 2);
+    const sf::Color color(255, 255, 255, fieldLineAlpha);
+    size_t vertex = 0;
+    for (const std::vector<sf::Vector2f> &points : linePoints)
+        for (size_t i = 1; i < points.size(); i++)
+        {
+            segments[vertex++] = sf::Vertex(points[i - 1], color);
+            segments[vertex++] = sf::Vertex(points[i], color);
+        }
+
+    if (debug == 9)
+        std::cout << "Field lines: traced " << lineCount << " lines with " << segmentCount << " segments" << std::endl;
+    return segments;
+}
+
+// Bogacki-Shampine 3(2) on the unit field direction, so the step is the length of the segment in pixels.
+// The physics engine calls the vector pointing towards the charges positive, the physical field is its opposite.
+void FieldLineTracer::traceLine(const ChargeStore &charges, const sf::Vector2u &size, const sf::Vector2f &start, const float direction, std::vector<sf::Vector2f> &points) const
+{
+    auto getDirection = [&charges, direction, this](const sf::Vector2f &pos)
+    {
+        const sf::Vector2f field = sumElectricField(charges.getX(), charges.getY(), charges.getCharge(), charges.size(), pos, kernel);
+        const float length = std::sqrt(field.x * field.x + field.y * field.y);
+        if (!(length > 0.0f) || !std::isfinite(length))
+            return sf::Vector2f(0.0f, 0.0f);
+        return field * (-direction / length);
+    };
+    auto isInside = [&size](const sf::Vector2f &pos)
+    {
+        return pos.x >= 0.0f && pos.y >= 0.0f && pos.x <= size.x && pos.y <= size.y;
+    };
+
+    if (!isInside(start))
+        return;
+    sf::Vector2f pos = start;
+    sf::Vector2f k1 = getDirection(pos);
+    float step = 1.0f;
+    points.push_back(pos);
+
+    while (points.size() < fieldLineMaxPoints && k1 != sf::Vector2f(0.0f, 0.0f))
+    {
+        const sf::Vector2f k2 = getDirection(pos + k1 * (step / 2.0f));
+        const sf::Vector2f k3 = getDirection(pos + k2 * (step * 3.0f / 4.0f));
+        const sf::Vector2f next = pos + (k1 * (2.0f / 9.0f) + k2 * (1.0f / 3.0f) + k3 * (4.0f / 9.0f)) * step;
+        const sf::Vector2f k4 = getDirection(next);
+
+        // Difference between the third and the embedded second order solution
+        const sf::Vector2f errorVector = (k1 * (5.0f / 72.0f) - k2 * (1.0f / 12.0f) - k3 * (1.0f / 9.0f) + k4 * (1.0f / 8.0f)) * step;
+        const float error = std::sqrt(errorVector.x * errorVector.x + errorVector.y * errorVector.y);
+
+        if (error <= fieldLineTolerance)
+        {
+            // The direction only turns around within a step when the line passed through a charge
+            const bool isReversed = k1.x * k4.x + k1.y * k4.y < 0.0f;
+            pos = next;
+            k1 = k4;
+            points.push_back(pos);
+            if (!isInside(pos) || isReversed)
+                return;
+        }
+
+        // Grow or shrink the step for the error to match the tolerance, the method is third order
+        const float factor = error == 0.0f ? 4.0f : 0.9f * std::cbrt(fieldLineTolerance / error);
+        step = std::min(fieldLineMaxStep, step * std::max(0.2f, std::min(4.0f, factor)));
+        if (step < fieldLineMinStep)
+            return;
+    }
+}
+
+// A single draw call for every line
+void FieldLineTracer::draw(sf::RenderTarget &target, sf::RenderStates states) const
+{
+    if (lines.getVertexCount() != 0)
+        target.draw(lines, states);
+}
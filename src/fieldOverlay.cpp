@@ -0,0 +1,196 @@
+#include <SFML\Graphics.hpp>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "fieldOverlay.h"
+#include "forceKernel.h"
+#include "threadPool.h"
+#include "settings.h"
+
+extern const char debug;
+
+// Empty overlay, the widest kernel of the CPU is used
+FieldOverlay::FieldOverlay()
+    : kernel(detectForceKernel()), columns(0), rows(0), tileColumns(0), tileRows(0), preparedRevision(0), preparedSize(0, 0), incrementalEdits(0)
+{
+}
+
+// Samples are in the centers of the cells, the texture is stretched so that texel centers land on them
+void FieldOverlay::resize(const sf::Vector2u &size)
+{
+    columns = std::max(1u, (size.x + fieldOverlayCellSize - 1) / fieldOverlayCellSize);
+    rows = std::max(1u, (size.y + fieldOverlayCellSize - 1) / fieldOverlayCellSize);
+    tileColumns = (columns + fieldOverlayTileSize - 1) / fieldOverlayTileSize;
+    tileRows = (rows + fieldOverlayTileSize - 1) / fieldOverlayTileSize;
+
+    const size_t sampleCount = static_cast<size_t>(columns) * rows;
+    fieldX.assign(sampleCount, 0.0f);
+    fieldY.assign(sampleCount, 0.0f);
+    potential.assign(sampleCount, 0.0f);
+    pixels.assign(sampleCount * 4, 0);
+    isTileDirty.assign(static_cast<size_t>(tileColumns) * tileRows, 1);
+
+    texture.create(columns, rows);
+    texture.setSmooth(true);
+    sprite.setTexture(texture, true);
+    sprite.setScale(static_cast<float>(fieldOverlayCellSize), static_cast<float>(fieldOverlayCellSize));
+}
+
+// Red and blue for the sign of the potential, green for the strength of the field, both saturate smoothly
+void FieldOverlay::colorSample(const float samplePotential, const float sampleFieldX, const float sampleFieldY, uint8_t *color)
+{
+    const float potentialRatio = samplePotential / (std::abs(samplePotential) + fieldOverlayPotentialScale);
+    const float fieldStrength = std::sqrt(sampleFieldX * sampleFieldX + sampleFieldY * sampleFieldY);
+    color[0] = static_cast<uint8_t>(255.0f * std::max(0.0f, potentialRatio));
+    color[1] = static_cast<uint8_t>(255.0f * fieldStrength / (fieldStrength + fieldOverlayFieldScale));
+    color[2] = static_cast<uint8_t>(255.0f * std::max(0.0f, -potentialRatio));
+    color[3] = fieldOverlayAlpha;
+}
+
+// Sum the charges row by row of the tile, a row of a tile is a single call of the lane kernel
+void FieldOverlay::accumulateTile(const size_t tile, const float *x, const float *y, const float *q, const size_t count, const bool isReset)
+{
+    const unsigned firstColumn = static_cast<unsigned>(tile % tileColumns) * fieldOverlayTileSize;
+    const unsigned firstRow = static_cast<unsigned>(tile / tileColumns) * fieldOverlayTileSize;
+    const unsigned width = std::min(fieldOverlayTileSize, columns - firstColumn);
+    const unsigned height = std::min(fieldOverlayTileSize, rows - firstRow);
+
+    float posX[fieldOverlayTileSize];
+    float posY[fieldOverlayTileSize];
+    float rowFieldX[fieldOverlayTileSize];
+    float rowFieldY[fieldOverlayTileSize];
+    float rowPotential[fieldOverlayTileSize];
+    for (unsigned column = 0; column < width; column++)
+        posX[column] = (firstColumn + column + 0.5f) * fieldOverlayCellSize;
+
+    bool isChanged = false;
+    for (unsigned row = firstRow; row < firstRow + height; row++)
+    {
+        std::fill(posY, posY + width, (row + 0.5f) * fieldOverlayCellSize);
+        sumFieldAndPotentialLanes(x, y, q, count, posX, posY, width, fieldOverlaySoftening, rowFieldX, rowFieldY, rowPotential, kernel);
+
+        const size_t first = static_cast<size_t>(row) * columns + firstColumn;
+        for (unsigned column = 0; column < width; column++)
+        {
+            const size_t sample = first + column;
+            if (isReset)
+            {
+                fieldX[sample] = rowFieldX[column];
+                fieldY[sample] = rowFieldY[column];
+                potential[sample] = rowPotential[column];
+            }
+            else
+            {
+                fieldX[sample] += rowFieldX[column];
+                fieldY[sample] += rowFieldY[column];
+                potential[sample] += rowPotential[column];
+            }
+
+            uint8_t color[4];
+            colorSample(potential[sample], fieldX[sample], fieldY[sample], color);
+            if (std::memcmp(color, &pixels[sample * 4], 4) != 0)
+            {
+                std::memcpy(&pixels[sample * 4], color, 4);
+                isChanged = true;
+            }
+        }
+    }
+    if (isChanged)
+        isTileDirty[tile] = 1;
+}
+
+// Apply the edits since the last update, recalculate everything if they aren't available or too many were added up
+void FieldOverlay::update(const ChargeStore &charges, const sf::Vector2u &size)
+{
+    if (charges.getRevision() == preparedRevision && size == preparedSize)
+        return;
+    if (!pool)
+        pool = std::make_unique<ThreadPool>();
+
+    const size_t tileCount = static_cast<size_t>(tileColumns) * tileRows;
+    std::vector<ChargeDelta> deltas;
+    if (preparedRevision == 0 || size != preparedSize || !charges.getDeltasSince(preparedRevision, deltas) ||
+        incrementalEdits + deltas.size() > fieldOverlayRefreshEdits)
+    {
+        if (size != preparedSize || tileCount == 0)
+            resize(size);
+        const float *x = charges.getX();
+        const float *y = charges.getY();
+        const float *q = charges.getCharge();
+        const size_t count = charges.size();
+        pool->parallelFor(static_cast<size_t>(tileColumns) * tileRows, 1, [this, x, y, q, count](const size_t begin, const size_t end)
+                          {
+                              for (size_t tile = begin; tile < end; tile++)
+                                  accumulateTile(tile, x, y, q, count, true);
+                          });
+        incrementalEdits = 0;
+        if (debug == 9)
+            std::cout << "Field overlay: summed " << count << " charges at " << fieldX.size() << " samples" << std::endl;
+    }
+    else
+    {
+        // Removing a charge is adding its opposite
+        std::vector<float> deltaX, deltaY, deltaQ;
+        for (const ChargeDelta &delta : deltas)
+        {
+            deltaX.push_back(delta.x);
+            deltaY.push_back(delta.y);
+            deltaQ.push_back(delta.type == ChargeDelta::Type::Add ? delta.q : -delta.q);
+        }
+        const float *x = deltaX.data();
+        const float *y = deltaY.data();
+        const float *q = deltaQ.data();
+        const size_t count = deltas.size();
+        pool->parallelFor(tileCount, 1, [this, x, y, q, count](const size_t begin, const size_t end)
+                          {
+                              for (size_t tile = begin; tile < end; tile++)
+                                  accumulateTile(tile, x, y, q, count, false);
+                          });
+        incrementalEdits += count;
+        if (debug == 9)
+            std::cout << "Field overlay: applied " << count << " obstacle edits" << std::endl;
+    }
+
+    preparedRevision = charges.getRevision();
+    preparedSize = size;
+    upload();
+}
+
+// Upload the whole image if most tiles changed, otherwise the changed tiles one by one
+void FieldOverlay::upload()
+{
+    const size_t dirtyCount = std::count(isTileDirty.begin(), isTileDirty.end(), 1);
+    if (dirtyCount * 2 > isTileDirty.size())
+    {
+        texture.update(pixels.data());
+        std::fill(isTileDirty.begin(), isTileDirty.end(), 0);
+        return;
+    }
+
+    std::vector<uint8_t> tilePixels(static_cast<size_t>(fieldOverlayTileSize) * fieldOverlayTileSize * 4);
+    for (size_t tile = 0; tile < isTileDirty.size(); tile++)
+    {
+        if (!isTileDirty[tile])
+            continue;
+        const unsigned firstColumn = static_cast<unsigned>(tile % tileColumns) * fieldOverlayTileSize;
+        const unsigned firstRow = static_cast<unsigned>(tile / tileColumns) * fieldOverlayTileSize;
+        const unsigned width = std::min(fieldOverlayTileSize, columns - firstColumn);
+        const unsigned height = std::min(fieldOverlayTileSize, rows - firstRow);
+        for (unsigned row = 0; row < height; row++)
+            std::memcpy(&tilePixels[static_cast<size_t>(row) * width * 4], &pixels[(static_cast<size_t>(firstRow + row) * columns + firstColumn) * 4], width * 4);
+        texture.update(tilePixels.data(), width, height, firstColumn, firstRow);
+        isTileDirty[tile] = 0;
+    }
+}
+
+// Nothing is drawn before the first update
+void FieldOverlay::draw(sf::RenderTarget &target, sf::RenderStates states) const
+{
+    if (preparedRevision != 0)
+        target.draw(sprite, states);
+}
@@ -0,0 +1,395 @@
+#include <SFML\System.hpp>
+#include <cmath>
+#include <algorithm>
+
+#include "forceKernel.h"
+
+// Vectorized kernels are compiled with function level target attributes, so the rest of the program
+// doesn't need to be compiled with -mavx2 and still runs on CPUs without AVX2.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHARGE_SIMD_KERNELS
+#include <immintrin.h>
+#endif
+
+// Detect supported instruction sets once
+ForceKernel detectForceKernel()
+{
+#ifdef CHARGE_SIMD_KERNELS
+    static const ForceKernel detected = []()
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            return ForceKernel::AVX2;
+        if (__builtin_cpu_supports("sse4.1"))
+            return ForceKernel::SSE4;
+        return ForceKernel::Scalar;
+    }();
+    return detected;
+#else
+    return ForceKernel::Scalar;
+#endif
+}
+
+// Name of kernel for debug output
+const char *getForceKernelName(const ForceKernel kernel)
+{
+    switch (kernel)
+    {
+    case ForceKernel::AVX2:
+        return "AVX2";
+    case ForceKernel::SSE4:
+        return "SSE4";
+    default:
+        return "Scalar";
+    }
+}
+
+// Reference implementation
+// Formula: sum(q_i * (ri / abs(ri)^3)), the square root and division is only done once per charge
+sf::Vector2f sumElectricFieldScalar(const float *x, const float *y, const float *q, const size_t count, const sf::Vector2f &pos)
+{
+    sf::Vector2f field(0.0f, 0.0f);
+    for (size_t i = 0; i < count; i++)
+    {
+        const float riX = x[i] - pos.x;
+        const float riY = y[i] - pos.y;
+        const float riLengthSquared = riX * riX + riY * riY;
+
+        // Charge divided by the cube of riLength
+        const float factor = q[i] / (riLengthSquared * std::sqrt(riLengthSquared));
+        field.x += factor * riX;
+        field.y += factor * riY;
+    }
+    return field;
+}
+
+// Field and potential at one position with softened distances, potential is the factor of the field times the squared distance
+static void sumFieldAndPotentialScalar(const float *x, const float *y, const float *q, const size_t count, const float posX, const float posY,
+                                       const float softening, float &fieldX, float &fieldY, float &potential)
+{
+    fieldX = fieldY = potential = 0.0f;
+    for (size_t i = 0; i < count; i++)
+    {
+        const float riX = x[i] - posX;
+        const float riY = y[i] - posY;
+        const float riLengthSquared = riX * riX + riY * riY + softening;
+        const float factor = q[i] / (riLengthSquared * std::sqrt(riLengthSquared));
+        fieldX += factor * riX;
+        fieldY += factor * riY;
+        potential += factor * riLengthSquared;
+    }
+}
+
+#ifdef CHARGE_SIMD_KERNELS
+
+// 4 charges per iteration, the remainder is summed with the scalar kernel
+__attribute__((target("sse4.1"))) static sf::Vector2f sumElectricFieldSSE4(const float *x, const float *y, const float *q, const size_t count, const sf::Vector2f &pos)
+{
+    const __m128 posX = _mm_set1_ps(pos.x);
+    const __m128 posY = _mm_set1_ps(pos.y);
+    __m128 fieldX = _mm_setzero_ps();
+    __m128 fieldY = _mm_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 riX = _mm_sub_ps(_mm_loadu_ps(x + i), posX);
+        const __m128 riY = _mm_sub_ps(_mm_loadu_ps(y + i), posY);
+        const __m128 riLengthSquared = _mm_add_ps(_mm_mul_ps(riX, riX), _mm_mul_ps(riY, riY));
+        const __m128 factor = _mm_div_ps(_mm_loadu_ps(q + i), _mm_mul_ps(riLengthSquared, _mm_sqrt_ps(riLengthSquared)));
+        fieldX = _mm_add_ps(fieldX, _mm_mul_ps(factor, riX));
+        fieldY = _mm_add_ps(fieldY, _mm_mul_ps(factor, riY));
+    }
+
+    // Horizontal sum of the lanes
+    alignas(16) float lanesX[4];
+    alignas(16) float lanesY[4];
+    _mm_store_ps(lanesX, fieldX);
+    _mm_store_ps(lanesY, fieldY);
+    sf::Vector2f field = sumElectricFieldScalar(x + i, y + i, q + i, count - i, pos);
+    field.x += (lanesX[0] + lanesX[1]) + (lanesX[2] + lanesX[3]);
+    field.y += (lanesY[0] + lanesY[1]) + (lanesY[2] + lanesY[3]);
+    return field;
+}
+
+// 8 charges per iteration, the remainder is summed with the scalar kernel
+__attribute__((target("avx2,fma"))) static sf::Vector2f sumElectricFieldAVX2(const float *x, const float *y, const float *q, const size_t count, const sf::Vector2f &pos)
+{
+    const __m256 posX = _mm256_set1_ps(pos.x);
+    const __m256 posY = _mm256_set1_ps(pos.y);
+    __m256 fieldX = _mm256_setzero_ps();
+    __m256 fieldY = _mm256_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256 riX = _mm256_sub_ps(_mm256_loadu_ps(x + i), posX);
+        const __m256 riY = _mm256_sub_ps(_mm256_loadu_ps(y + i), posY);
+        const __m256 riLengthSquared = _mm256_fmadd_ps(riX, riX, _mm256_mul_ps(riY, riY));
+        const __m256 factor = _mm256_div_ps(_mm256_loadu_ps(q + i), _mm256_mul_ps(riLengthSquared, _mm256_sqrt_ps(riLengthSquared)));
+        fieldX = _mm256_fmadd_ps(factor, riX, fieldX);
+        fieldY = _mm256_fmadd_ps(factor, riY, fieldY);
+    }
+
+    // Horizontal sum of the lanes
+    alignas(32) float lanesX[8];
+    alignas(32) float lanesY[8];
+    _mm256_store_ps(lanesX, fieldX);
+    _mm256_store_ps(lanesY, fieldY);
+    sf::Vector2f field = sumElectricFieldScalar(x + i, y + i, q + i, count - i, pos);
+    for (size_t lane = 0; lane < 8; lane++)
+    {
+        field.x += lanesX[lane];
+        field.y += lanesY[lane];
+    }
+    return field;
+}
+
+// 4 positions per tile, every charge is broadcast to the lanes once per tile
+__attribute__((target("sse4.1"))) static void sumElectricFieldLanesSSE4(const float *x, const float *y, const float *q, const size_t count,
+                                                                       const float *posX, const float *posY, float *fieldX, float *fieldY)
+{
+    const __m128 laneX = _mm_loadu_ps(posX);
+    const __m128 laneY = _mm_loadu_ps(posY);
+    __m128 sumX = _mm_setzero_ps();
+    __m128 sumY = _mm_setzero_ps();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const __m128 riX = _mm_sub_ps(_mm_set1_ps(x[i]), laneX);
+        const __m128 riY = _mm_sub_ps(_mm_set1_ps(y[i]), laneY);
+        const __m128 riLengthSquared = _mm_add_ps(_mm_mul_ps(riX, riX), _mm_mul_ps(riY, riY));
+        const __m128 factor = _mm_div_ps(_mm_set1_ps(q[i]), _mm_mul_ps(riLengthSquared, _mm_sqrt_ps(riLengthSquared)));
+        sumX = _mm_add_ps(sumX, _mm_mul_ps(factor, riX));
+        sumY = _mm_add_ps(sumY, _mm_mul_ps(factor, riY));
+    }
+
+    _mm_storeu_ps(fieldX, sumX);
+    _mm_storeu_ps(fieldY, sumY);
+}
+
+// 8 positions per tile, every charge is broadcast to the lanes once per tile
+__attribute__((target("avx2,fma"))) static void sumElectricFieldLanesAVX2(const float *x, const float *y, const float *q, const size_t count,
+                                                                         const float *posX, const float *posY, float *fieldX, float *fieldY)
+{
+    const __m256 laneX = _mm256_loadu_ps(posX);
+    const __m256 laneY = _mm256_loadu_ps(posY);
+    __m256 sumX = _mm256_setzero_ps();
+    __m256 sumY = _mm256_setzero_ps();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const __m256 riX = _mm256_sub_ps(_mm256_broadcast_ss(x + i), laneX);
+        const __m256 riY = _mm256_sub_ps(_mm256_broadcast_ss(y + i), laneY);
+        const __m256 riLengthSquared = _mm256_fmadd_ps(riX, riX, _mm256_mul_ps(riY, riY));
+        const __m256 factor = _mm256_div_ps(_mm256_broadcast_ss(q + i), _mm256_mul_ps(riLengthSquared, _mm256_sqrt_ps(riLengthSquared)));
+        sumX = _mm256_fmadd_ps(factor, riX, sumX);
+        sumY = _mm256_fmadd_ps(factor, riY, sumY);
+    }
+
+    _mm256_storeu_ps(fieldX, sumX);
+    _mm256_storeu_ps(fieldY, sumY);
+}
+
+// Field and potential at 4 positions, every charge is broadcast to the lanes once
+__attribute__((target("sse4.1"))) static void sumFieldAndPotentialLanesSSE4(const float *x, const float *y, const float *q, const size_t count,
+                                                                           const float *posX, const float *posY, const float softening,
+                                                                           float *fieldX, float *fieldY, float *potential)
+{
+    const __m128 laneX = _mm_loadu_ps(posX);
+    const __m128 laneY = _mm_loadu_ps(posY);
+    const __m128 soft = _mm_set1_ps(softening);
+    __m128 sumX = _mm_setzero_ps();
+    __m128 sumY = _mm_setzero_ps();
+    __m128 sumPotential = _mm_setzero_ps();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const __m128 riX = _mm_sub_ps(_mm_set1_ps(x[i]), laneX);
+        const __m128 riY = _mm_sub_ps(_mm_set1_ps(y[i]), laneY);
+        const __m128 riLengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(riX, riX), _mm_mul_ps(riY, riY)), soft);
+        const __m128 factor = _mm_div_ps(_mm_set1_ps(q[i]), _mm_mul_ps(riLengthSquared, _mm_sqrt_ps(riLengthSquared)));
+        sumX = _mm_add_ps(sumX, _mm_mul_ps(factor, riX));
+        sumY = _mm_add_ps(sumY, _mm_mul_ps(factor, riY));
+        sumPotential = _mm_add_ps(sumPotential, _mm_mul_ps(factor, riLengthSquared));
+    }
+
+    _mm_storeu_ps(fieldX, sumX);
+    _mm_storeu_ps(fieldY, sumY);
+    _mm_storeu_ps(potential, sumPotential);
+}
+
+// Field and potential at 8 positions, every charge is broadcast to the lanes once
+__attribute__((target("avx2,fma"))) static void sumFieldAndPotentialLanesAVX2(const float *x, const float *y, const float *q, const size_t count,
+                                                                             const float *posX, const float *posY, const float softening,
+                                                                             float *fieldX, float *fieldY, float *potential)
+{
+    const __m256 laneX = _mm256_loadu_ps(posX);
+    const __m256 laneY = _mm256_loadu_ps(posY);
+    const __m256 soft = _mm256_set1_ps(softening);
+    __m256 sumX = _mm256_setzero_ps();
+    __m256 sumY = _mm256_setzero_ps();
+    __m256 sumPotential = _mm256_setzero_ps();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const __m256 riX = _mm256_sub_ps(_mm256_broadcast_ss(x + i), laneX);
+        const __m256 riY = _mm256_sub_ps(_mm256_broadcast_ss(y + i), laneY);
+        const __m256 riLengthSquared = _mm256_fmadd_ps(riX, riX, _mm256_fmadd_ps(riY, riY, soft));
+        const __m256 factor = _mm256_div_ps(_mm256_broadcast_ss(q + i), _mm256_mul_ps(riLengthSquared, _mm256_sqrt_ps(riLengthSquared)));
+        sumX = _mm256_fmadd_ps(factor, riX, sumX);
+        sumY = _mm256_fmadd_ps(factor, riY, sumY);
+        sumPotential = _mm256_fmadd_ps(factor, riLengthSquared, sumPotential);
+    }
+
+    _mm256_storeu_ps(fieldX, sumX);
+    _mm256_storeu_ps(fieldY, sumY);
+    _mm256_storeu_ps(potential, sumPotential);
+}
+
+#endif
+
+// Lanes of a tile of the given kernel
+size_t getForceKernelLaneCount(const ForceKernel kernel)
+{
+#ifdef CHARGE_SIMD_KERNELS
+    switch (kernel)
+    {
+    case ForceKernel::AVX2:
+        return 8;
+    case ForceKernel::SSE4:
+        return 4;
+    default:
+        break;
+    }
+#else
+    (void)kernel;
+#endif
+    return 1;
+}
+
+// Split positions into tiles, the last tile is padded with copies of its last position
+void sumElectricFieldLanes(const float *x, const float *y, const float *q, const size_t count,
+                           const float *posX, const float *posY, const size_t laneCount,
+                           float *fieldX, float *fieldY, const ForceKernel kernel)
+{
+    const size_t tileSize = getForceKernelLaneCount(kernel);
+    if (tileSize == 1)
+    {
+        for (size_t lane = 0; lane < laneCount; lane++)
+        {
+            const sf::Vector2f field = sumElectricFieldScalar(x, y, q, count, sf::Vector2f(posX[lane], posY[lane]));
+            fieldX[lane] = field.x;
+            fieldY[lane] = field.y;
+        }
+        return;
+    }
+
+#ifdef CHARGE_SIMD_KERNELS
+    for (size_t first = 0; first < laneCount; first += tileSize)
+    {
+        const size_t used = std::min(tileSize, laneCount - first);
+
+        // Full tiles are read and written in place
+        float tilePosX[8], tilePosY[8], tileFieldX[8], tileFieldY[8];
+        const float *inX = posX + first;
+        const float *inY = posY + first;
+        float *outX = fieldX + first;
+        float *outY = fieldY + first;
+        if (used < tileSize)
+        {
+            for (size_t lane = 0; lane < tileSize; lane++)
+            {
+                tilePosX[lane] = inX[std::min(lane, used - 1)];
+                tilePosY[lane] = inY[std::min(lane, used - 1)];
+            }
+            inX = tilePosX;
+            inY = tilePosY;
+            outX = tileFieldX;
+            outY = tileFieldY;
+        }
+
+        if (kernel == ForceKernel::AVX2)
+            sumElectricFieldLanesAVX2(x, y, q, count, inX, inY, outX, outY);
+        else
+            sumElectricFieldLanesSSE4(x, y, q, count, inX, inY, outX, outY);
+
+        if (used < tileSize)
+        {
+            std::copy(tileFieldX, tileFieldX + used, fieldX + first);
+            std::copy(tileFieldY, tileFieldY + used, fieldY + first);
+        }
+    }
+#endif
+}
+
+// Same tiling as sumElectricFieldLanes(), with a third output
+void sumFieldAndPotentialLanes(const float *x, const float *y, const float *q, const size_t count,
+                               const float *posX, const float *posY, const size_t laneCount, const float softening,
+                               float *fieldX, float *fieldY, float *potential, const ForceKernel kernel)
+{
+    const size_t tileSize = getForceKernelLaneCount(kernel);
+    if (tileSize == 1)
+    {
+        for (size_t lane = 0; lane < laneCount; lane++)
+            sumFieldAndPotentialScalar(x, y, q, count, posX[lane], posY[lane], softening, fieldX[lane], fieldY[lane], potential[lane]);
+        return;
+    }
+
+#ifdef CHARGE_SIMD_KERNELS
+    for (size_t first = 0; first < laneCount; first += tileSize)
+    {
+        const size_t used = std::min(tileSize, laneCount - first);
+
+        // Full tiles are read and written in place
+        float tilePosX[8], tilePosY[8], tileFieldX[8], tileFieldY[8], tilePotential[8];
+        const float *inX = posX + first;
+        const float *inY = posY + first;
+        float *outX = fieldX + first;
+        float *outY = fieldY + first;
+        float *outPotential = potential + first;
+        if (used < tileSize)
+        {
+            for (size_t lane = 0; lane < tileSize; lane++)
+            {
+                tilePosX[lane] = inX[std::min(lane, used - 1)];
+                tilePosY[lane] = inY[std::min(lane, used - 1)];
+            }
+            inX = tilePosX;
+            inY = tilePosY;
+            outX = tileFieldX;
+            outY = tileFieldY;
+            outPotential = tilePotential;
+        }
+
+        if (kernel == ForceKernel::AVX2)
+            sumFieldAndPotentialLanesAVX2(x, y, q, count, inX, inY, softening, outX, outY, outPotential);
+        else
+            sumFieldAndPotentialLanesSSE4(x, y, q, count, inX, inY, softening, outX, outY, outPotential);
+
+        if (used < tileSize)
+        {
+            std::copy(tileFieldX, tileFieldX + used, fieldX + first);
+            std::copy(tileFieldY, tileFieldY + used, fieldY + first);
+            std::copy(tilePotential, tilePotential + used, potential + first);
+        }
+    }
+#endif
+}
+
+// Dispatch to the requested kernel
+sf::Vector2f sumElectricField(const float *x, const float *y, const float *q, const size_t count, const sf::Vector2f &pos, const ForceKernel kernel)
+{
+#ifdef CHARGE_SIMD_KERNELS
+    switch (kernel)
+    {
+    case ForceKernel::AVX2:
+        return sumElectricFieldAVX2(x, y, q, count, pos);
+    case ForceKernel::SSE4:
+        return sumElectricFieldSSE4(x, y, q, count, pos);
+    default:
+        break;
+    }
+#endif
+    return sumElectricFieldScalar(x, y, q, count, pos);
+}
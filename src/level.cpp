@@ -2,6 +2,7 @@
 #include <SFML\Graphics.hpp>
 #include <string>
 #include <iostream>
+#include <algorithm>
 
 #include "obstacle.h"
 #include "player.h"
@@ -12,10 +13,29 @@ extern const char debug;
 extern const unsigned levelNameCharLimit;
 
 Level::Level(const std::string &levelName, const sf::Vector2u &levelSize, const std::vector<std::shared_ptr<Obstacle>> &obstacles, const sf::Vector2f &playerStartPos)
-    : name(levelName), size(levelSize), obstacles(obstacles), playerStartPos(playerStartPos)
+    : name(levelName), size(levelSize), obstacles(obstacles), obstacleHash(spatialHashCellSize), playerStartPos(playerStartPos)
 {
+    // Fill charge store with the physical data of the obstacles and hash their bodies
+    charges.reserve(obstacles.size());
+    for (size_t i = 0; i < obstacles.size(); i++)
+    {
+        const std::shared_ptr<sf::CircleShape> &body = obstacles[i]->getBody();
+        charges.add(body->getPosition().x, body->getPosition().y, obstacles[i]->getElectricCharge(), obstacles[i]->getCollisionRadius());
+        obstacleHash.insert(i, body->getPosition(), body->getRadius());
+    }
 }
 
+// Create an obstacle for every charge of the loaded data
+Level::Level(const LevelData &data)
+    : name(data.name), size(data.size), charges(data.charges), obstacleHash(spatialHashCellSize), playerStartPos(data.playerStartPos)
+{
+    obstacles.reserve(charges.size());
+    for (size_t i = 0; i < charges.size(); i++)
+    {
+        obstacles.push_back(std::make_shared<Obstacle>(charges.getCollisionRadius()[i], charges.getCharge()[i], sf::Vector2f(charges.getX()[i], charges.getY()[i])));
+        obstacleHash.insert(i, obstacles.back()->getBody()->getPosition(), obstacles.back()->getBody()->getRadius());
+    }
+}
 
 // Sets name of level. Max character limit defined in settings.h
 const bool Level::setName(const std::string& newName)
@@ -33,6 +53,39 @@ void Level::addObstacle(const std::shared_ptr<Obstacle> &newObstacle)
 {
     // Obstacles stored as shared pointers, because of rendering as drawable*
     obstacles.push_back(newObstacle);
+    // Keep charge store and hash in sync with obstacles
+    charges.add(newObstacle->getBody()->getPosition().x, newObstacle->getBody()->getPosition().y, newObstacle->getElectricCharge(), newObstacle->getCollisionRadius());
+    obstacleHash.insert(obstacles.size() - 1, newObstacle->getBody()->getPosition(), newObstacle->getBody()->getRadius());
     if (debug == 3)
         std::cout << "obstacle count:\t" << obstacles.size() << std::endl;
-}
\ No newline at end of file
+}
+
+// Remove obstacle from level, the last obstacle takes its place so nothing else moves
+void Level::removeObstacle(size_t idx)
+{
+    const size_t last = obstacles.size() - 1;
+    obstacleHash.remove(idx, obstacles[idx]->getBody()->getPosition());
+    if (idx != last)
+        obstacleHash.rename(last, idx, obstacles[last]->getBody()->getPosition());
+
+    obstacles[idx] = std::move(obstacles[last]);
+    obstacles.pop_back();
+    charges.swapRemove(idx);
+}
+
+// Remove obstacles from the highest index down, so the obstacles moved by swap-and-pop are never ones still to remove
+void Level::removeObstacles(std::vector<size_t> &indices)
+{
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    for (auto it = indices.rbegin(); it != indices.rend(); ++it)
+        removeObstacle(*it);
+}
+
+// Clear all obstacles from level
+void Level::clearObstacles()
+{
+    obstacles.clear();
+    charges.clear();
+    obstacleHash.clear();
+}
@@ -4,10 +4,27 @@
 #include <vector>
 #include <iostream>
 #include <memory>
+#include <algorithm>
+#include <filesystem>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <future>
+#include <iterator>
+#include <exception>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <cmath>
 
 #include "levelManager.h"
+#include "levelData.h"
+#include "levelFormat.h"
+#include "mappedFile.h"
+#include "compression.h"
 #include "nlohmann\json.hpp"
-#include "obstacle.h"
 #include "settings.h"
 
 extern const char debug;
@@ -19,218 +36,1259 @@ LevelManager *LevelManager::getInstance()
     return &instance;
 }
 
-// Constructor
+// Constructor, the catalog itself is only read when it is first needed
 LevelManager::LevelManager()
+    : isCatalogLoaded(false), isCatalogChanged(false), cacheBytes(0), cacheStats{0, 0, 0}
 {
-    // See if levels.txt (index of loadable levels) exists
-    std::ifstream loadablesFile;
-    loadablesFile.open("levels/index.txt");
-    if (!loadablesFile)
+    // Check if the "levels" directory exists
+    if (!std::filesystem::exists("levels"))
     {
+        // Create the "levels" directory
+        std::filesystem::create_directory("levels");
         if (debug == 5)
-            std::cout << "Couldn't locate index.txt..." << std::endl;
-        // Check if the "levels" directory exists
-        if (!std::filesystem::exists("levels"))
+            std::cout << "Created \"levels\" directory" << std::endl;
+    }
+}
+
+// Destructor writes the catalog if it changed since it was last written
+LevelManager::~LevelManager()
+{
+    if (isCatalogChanged)
+        updateIndex();
+}
+
+namespace
+{
+    const char *const catalogPath = "levels/catalog.txt";
+    const char *const catalogHeader = "catalog 2";
+    const char *const oldCatalogHeader = "catalog 1"; // Written before the size of the journals was recorded
+
+    // File extension of a level format, also used in the catalog
+    const char *getFormatExtension(const LevelFormat format)
+    {
+        switch (format)
         {
-            // Create the "levels" directory
-            std::filesystem::create_directory("levels");
-            if (debug == 5)
-                std::cout << "Created \"levels\" directory" << std::endl;
+        case LevelFormat::Binary:
+            return "lvl";
+        case LevelFormat::Compressed:
+            return "clvl";
+        default:
+            return "json";
         }
+    }
+
+    // Level format of a file extension (without the dot), JSON if it isn't one of the others
+    LevelFormat getExtensionFormat(const std::string &extension)
+    {
+        if (extension == "lvl")
+            return LevelFormat::Binary;
+        if (extension == "clvl")
+            return LevelFormat::Compressed;
+        return LevelFormat::Json;
+    }
 
-        // Check if the "index.txt" file exists inside the "levels" directory
-        std::ifstream indexFile("levels/index.txt");
-        if (!indexFile)
+    // 64 bit FNV-1a hash of a buffer
+    uint64_t hashBytes(const unsigned char *data, const size_t size)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < size; i++)
         {
-            // Create the "index.txt" file inside the "levels" directory
-            std::ofstream newIndexFile("levels/index.txt");
-            if (!newIndexFile)
+            hash ^= data[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Path of the journal of a level
+    std::string getJournalPath(const std::string &levelName)
+    {
+        return "./levels/" + levelName + ".journal";
+    }
+
+    // Check of a journal record, a torn record doesn't match it
+    uint32_t getRecordCheck(const LevelJournalRecord &record)
+    {
+        return static_cast<uint32_t>(hashBytes(reinterpret_cast<const unsigned char *>(&record), offsetof(LevelJournalRecord, check)));
+    }
+}
+
+// Read the catalog, or build it from the index of earlier versions
+void LevelManager::ensureCatalog() const
+{
+    if (isCatalogLoaded)
+        return;
+    isCatalogLoaded = true;
+
+    std::ifstream catalogFile(catalogPath);
+    std::string line;
+    if (catalogFile && std::getline(catalogFile, line) && (line == catalogHeader || line == oldCatalogHeader))
+    {
+        const bool hasJournalSize = line == catalogHeader;
+        // One level per line, fields separated by tabs
+        while (std::getline(catalogFile, line))
+        {
+            std::istringstream fields(line);
+            LevelInfo info;
+            info.journalSize = 0;
+            std::string format;
+            if (!std::getline(fields, info.name, '\t') || !(fields >> format >> info.fileSize >> info.obstacleCount >> info.minX >> info.minY >> info.maxX >> info.maxY >> std::hex >> info.checksum >> std::dec) ||
+                (hasJournalSize && !(fields >> info.journalSize)))
             {
                 if (debug == 5)
-                    std::cout << "Couldn't create 'index.txt' file" << std::endl;
-                return;
+                    std::cout << "Skipped malformed catalog line: " + line << std::endl;
+                continue;
             }
-            // Close index file
-            newIndexFile.close();
-            if (debug == 5)
-                std::cout << "Created 'index.txt' file" << std::endl;
+            info.format = getExtensionFormat(format);
+            catalogIndex[info.name] = catalog.size();
+            catalog.push_back(info);
         }
-        indexFile.close();
+        if (debug == 5)
+            std::cout << "Loaded catalog.txt..." << std::endl;
         return;
     }
-    // If yes load loadables
+
+    // No catalog yet, describe every level listed in index.txt once
+    std::ifstream indexFile("levels/index.txt");
     std::string levelName;
-    while (loadablesFile >> levelName)
+    while (indexFile >> levelName)
     {
-        loadables.push_back(levelName);
+        if (catalogIndex.count(levelName) != 0)
+            continue;
+        const LevelFormat format = std::filesystem::exists(getLevelPath(levelName, LevelFormat::Binary)) ? LevelFormat::Binary : LevelFormat::Json;
+        const std::string path = getLevelPath(levelName, format);
+        try
+        {
+            const LevelInfo info = describeLevel(readLevelFile(path, nullptr), path, format);
+            catalogIndex[levelName] = catalog.size();
+            catalog.push_back(info);
+        }
+        catch (const std::exception &e)
+        {
+            if (debug == 5)
+                std::cout << "Couldn't add " + levelName + " to the catalog: " + e.what() << std::endl;
+        }
     }
     if (debug == 5)
-        std::cout << "Loaded index.txt..." << std::endl;
-    loadablesFile.close();
+        std::cout << "Built catalog from index.txt..." << std::endl;
+    updateIndex();
 }
 
-// Destructor updates index when destroying LevelManager
-LevelManager::~LevelManager()
+// Describe a level file for the catalog
+LevelInfo LevelManager::describeLevel(const LevelData &data, const std::string &path, const LevelFormat format)
 {
-    updateIndex();
+    LevelInfo info{data.name, format, 0, data.charges.size(), 0.0f, 0.0f, 0.0f, 0.0f, 0, 0};
+
+    // Bounding box of the obstacles
+    const float *x = data.charges.getX();
+    const float *y = data.charges.getY();
+    for (size_t i = 0; i < data.charges.size(); i++)
+    {
+        info.minX = i == 0 ? x[i] : std::min(info.minX, x[i]);
+        info.minY = i == 0 ? y[i] : std::min(info.minY, y[i]);
+        info.maxX = i == 0 ? x[i] : std::max(info.maxX, x[i]);
+        info.maxY = i == 0 ? y[i] : std::max(info.maxY, y[i]);
+    }
+
+    // Size and checksum of the file as it is on disk
+    MappedFile file(path);
+    info.fileSize = file.getSize();
+    info.checksum = hashBytes(file.getData(), file.getSize());
+    return info;
 }
 
-// Update index file based on loadables
+// Write the catalog to a temporary file then replace the old catalog with it
 void LevelManager::updateIndex() const
 {
-    // Open levels.txt for writing
-    std::ofstream loadablesFile;
-    loadablesFile.open("levels/index.txt");
-    if (!loadablesFile)
+    ensureCatalog();
+
+    const std::string temporaryPath = std::string(catalogPath) + ".tmp";
+    std::ofstream catalogFile(temporaryPath, std::ios::trunc);
+    if (!catalogFile)
+    {
+        if (debug == 5)
+            std::cout << "Couldn't open catalog.txt for writing" << std::endl;
+        return;
+    }
+
+    // Floats are written with enough digits to be read back exactly
+    catalogFile << catalogHeader << "\n";
+    catalogFile.precision(9);
+    for (const LevelInfo &info : catalog)
+    {
+        catalogFile << info.name << '\t' << getFormatExtension(info.format) << '\t' << info.fileSize << '\t' << info.obstacleCount
+                    << '\t' << info.minX << '\t' << info.minY << '\t' << info.maxX << '\t' << info.maxY
+                    << '\t' << std::hex << info.checksum << std::dec << '\t' << info.journalSize << "\n";
+    }
+    catalogFile.close();
+    if (!catalogFile)
     {
         if (debug == 5)
-            std::cout << "Couldn't open index.txt for writing" << std::endl;
+            std::cout << "Couldn't write catalog.txt" << std::endl;
         return;
     }
 
-    // Write loadables to the file, separated by newline
-    for (const std::string &levelName : loadables)
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, catalogPath, error);
+    if (error)
     {
-        loadablesFile << levelName << "\n";
         if (debug == 5)
-            std::cout << "Loaded " + levelName + " to index.txt..." << std::endl;
+            std::cout << "Couldn't replace catalog.txt" << std::endl;
+        return;
     }
-    loadablesFile.close();
+    isCatalogChanged = false;
     if (debug == 5)
-        std::cout << "Finished saving index.txt" << std::endl;
+        std::cout << "Finished saving catalog.txt" << std::endl;
+}
+
+// Number of levels in the catalog
+size_t LevelManager::getLevelCount() const
+{
+    ensureCatalog();
+    return catalog.size();
 }
 
-// Loads a level by name
-Level LevelManager::loadLevel(const std::string &levelName) const
+// Catalog entry by position
+const LevelInfo &LevelManager::getLevelInfo(const size_t levelIndex) const
 {
-    // Look for level to be loaded in loadables
-    if (std::find(loadables.begin(), loadables.end(), levelName) != loadables.end())
+    ensureCatalog();
+    return catalog.at(levelIndex);
+}
+
+// Catalog entry by name
+const LevelInfo *LevelManager::findLevelInfo(const std::string &levelName) const
+{
+    ensureCatalog();
+    const auto it = catalogIndex.find(levelName);
+    return it == catalogIndex.end() ? nullptr : &catalog[it->second];
+}
+
+// Path of the file of a level in the given format
+std::string LevelManager::getLevelPath(const std::string &levelName, const LevelFormat format)
+{
+    return "./levels/" + levelName + "." + getFormatExtension(format);
+}
+
+namespace
+{
+    // Receives the events of the streaming JSON parser and builds the level data from them
+    // Obstacles are pushed into the charge store as soon as their object closes, no DOM is built
+    class LevelSaxHandler : public nlohmann::json_sax<nlohmann::json>
     {
-        // Try to open the json file
-        std::ifstream levelFile("./levels/" + levelName + ".json");
+    private:
+        // Keys of the level schema, every other key is ignored
+        enum class Field
+        {
+            Other,
+            Name,
+            Size,
+            PlayerStartPos,
+            Obstacles,
+            Position,
+            Charge,
+            Radius,
+            X,
+            Y
+        };
+
+        // Fields an obstacle must have, as bits
+        static const unsigned hasX = 1, hasY = 2, hasCharge = 4, hasRadius = 8, hasEverything = 15;
+
+        LevelData &data;
+        std::vector<Field> containers; // Key every open object and array was opened under, the root is Other
+        Field currentKey;
+        unsigned sizeFields;
+        unsigned startFields;
+        unsigned obstacleFields;
+        float obstacleX, obstacleY, obstacleCharge, obstacleRadius;
+
+        static Field parseKey(const std::string &key)
+        {
+            if (key == "x")
+                return Field::X;
+            if (key == "y")
+                return Field::Y;
+            if (key == "charge")
+                return Field::Charge;
+            if (key == "radius")
+                return Field::Radius;
+            if (key == "position")
+                return Field::Position;
+            if (key == "obstacles")
+                return Field::Obstacles;
+            if (key == "size")
+                return Field::Size;
+            if (key == "playerStartPos")
+                return Field::PlayerStartPos;
+            if (key == "name")
+                return Field::Name;
+            return Field::Other;
+        }
+
+        // Whether the open containers are exactly the given path below the root
+        bool isAt(const std::initializer_list<Field> path) const
+        {
+            return containers.size() == path.size() + 1 && std::equal(path.begin(), path.end(), containers.begin() + 1);
+        }
+
+        // Store a number by where it is in the document
+        bool number(const double value)
+        {
+            const unsigned axis = currentKey == Field::X ? 1 : currentKey == Field::Y ? 2 : 0;
+            if (axis != 0 && isAt({Field::Size}))
+            {
+                (axis == 1 ? data.size.x : data.size.y) = static_cast<unsigned>(value);
+                sizeFields |= axis;
+            }
+            else if (axis != 0 && isAt({Field::PlayerStartPos}))
+            {
+                (axis == 1 ? data.playerStartPos.x : data.playerStartPos.y) = static_cast<float>(value);
+                startFields |= axis;
+            }
+            else if (axis != 0 && isAt({Field::Obstacles, Field::Other, Field::Position}))
+            {
+                (axis == 1 ? obstacleX : obstacleY) = static_cast<float>(value);
+                obstacleFields |= axis == 1 ? hasX : hasY;
+            }
+            else if (isAt({Field::Obstacles, Field::Other}))
+            {
+                if (currentKey == Field::Charge)
+                {
+                    obstacleCharge = static_cast<float>(value);
+                    obstacleFields |= hasCharge;
+                }
+                else if (currentKey == Field::Radius)
+                {
+                    obstacleRadius = static_cast<float>(value);
+                    obstacleFields |= hasRadius;
+                }
+            }
+            return true;
+        }
+
+        bool open()
+        {
+            containers.push_back(currentKey);
+            currentKey = Field::Other;
+            if (isAt({Field::Obstacles, Field::Other}))
+                obstacleFields = 0;
+            return true;
+        }
+
+        bool close()
+        {
+            // An obstacle object closes, add it to the store
+            if (isAt({Field::Obstacles, Field::Other}))
+            {
+                if (obstacleFields != hasEverything)
+                    throw std::runtime_error("LevelManager: Obstacle " + std::to_string(data.charges.size()) + " is missing a field");
+                data.charges.add(obstacleX, obstacleY, obstacleCharge, obstacleRadius);
+            }
+            containers.pop_back();
+            currentKey = Field::Other;
+            return true;
+        }
+
+    public:
+        explicit LevelSaxHandler(LevelData &levelData)
+            : data(levelData), currentKey(Field::Other), sizeFields(0), startFields(0), obstacleFields(0),
+              obstacleX(0.0f), obstacleY(0.0f), obstacleCharge(0.0f), obstacleRadius(0.0f)
+        {
+        }
+
+        // Check that the level had every required field
+        void finish(const std::string &path) const
+        {
+            if (sizeFields != 3 || startFields != 3)
+                throw std::runtime_error("LevelManager: Level is missing its size or player start position: " + path);
+        }
+
+        bool null() override { return true; }
+        bool boolean(bool) override { return true; }
+        bool number_integer(number_integer_t value) override { return number(static_cast<double>(value)); }
+        bool number_unsigned(number_unsigned_t value) override { return number(static_cast<double>(value)); }
+        bool number_float(number_float_t value, const string_t &) override { return number(value); }
+        bool binary(binary_t &) override { return true; }
+        bool start_object(std::size_t) override { return open(); }
+        bool end_object() override { return close(); }
+        bool start_array(std::size_t) override { return open(); }
+        bool end_array() override { return close(); }
+
+        bool string(string_t &value) override
+        {
+            if (currentKey == Field::Name && containers.size() == 1)
+                data.name = value;
+            return true;
+        }
+
+        bool key(string_t &value) override
+        {
+            currentKey = parseKey(value);
+            return true;
+        }
+
+        bool parse_error(std::size_t position, const std::string &, const nlohmann::detail::exception &e) override
+        {
+            throw std::runtime_error("LevelManager: JSON error at byte " + std::to_string(position) + ": " + e.what());
+        }
+    };
+
+    // Walks the text of a level file for the parser and reports how far it got every 64 KiB
+    class ProgressIterator
+    {
+    private:
+        const char *position;
+        const char *begin;
+        LevelLoadProgress *progress;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = char;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const char *;
+        using reference = const char &;
+
+        ProgressIterator(const char *current, const char *first, LevelLoadProgress *loadProgress)
+            : position(current), begin(first), progress(loadProgress)
+        {
+        }
+
+        reference operator*() const { return *position; }
+        bool operator==(const ProgressIterator &other) const { return position == other.position; }
+        bool operator!=(const ProgressIterator &other) const { return position != other.position; }
+
+        ProgressIterator &operator++()
+        {
+            ++position;
+            if (((position - begin) & 0xFFFF) == 0)
+                progress->loadedBytes.store(position - begin, std::memory_order_relaxed);
+            return *this;
+        }
+
+        ProgressIterator operator++(int)
+        {
+            ProgressIterator previous = *this;
+            ++*this;
+            return previous;
+        }
+    };
+
+    // Read a JSON level file in a single streaming pass over the mapped file
+    LevelData readJsonLevel(const std::string &path, LevelLoadProgress *progress)
+    {
+        const MappedFile file(path);
+        const char *text = reinterpret_cast<const char *>(file.getData());
+
+        // The shortest obstacle object takes more than 48 bytes, so the store never has to grow while parsing
+        LevelData data;
+        data.name = std::filesystem::path(path).stem().string();
+        data.charges.reserve(file.getSize() / 48);
+
+        LevelSaxHandler handler(data);
+        if (progress)
+        {
+            progress->totalBytes = file.getSize();
+            nlohmann::json::sax_parse(ProgressIterator(text, text, progress), ProgressIterator(text + file.getSize(), text, progress), &handler);
+            progress->loadedBytes = file.getSize();
+        }
+        else
+            nlohmann::json::sax_parse(text, text + file.getSize(), &handler);
+        handler.finish(path);
+        return data;
+    }
+
+    // Check that an array of the binary format lies inside the file and is aligned for floats
+    bool isArrayInFile(const uint64_t offset, const uint64_t count, const size_t fileSize)
+    {
+        return offset % alignof(float) == 0 && offset <= fileSize && count <= (fileSize - offset) / sizeof(float);
+    }
+
+    // Map a binary level file, the charge store uses the obstacle arrays in place
+    LevelData readBinaryLevel(const std::string &path, LevelLoadProgress *progress)
+    {
+        const std::shared_ptr<const MappedFile> file = std::make_shared<const MappedFile>(path);
+        const unsigned char *bytes = file->getData();
+
+        // Validate header before trusting any offset
+        BinaryLevelHeader header;
+        if (file->getSize() < sizeof(header))
+            throw std::runtime_error("LevelManager: Truncated level file: " + path);
+        std::memcpy(&header, bytes, sizeof(header));
+        if (std::memcmp(header.magic, binaryLevelMagic, sizeof(binaryLevelMagic)) != 0)
+            throw std::runtime_error("LevelManager: Not a binary level file: " + path);
+        if (header.version == 0 || header.version > binaryLevelVersion)
+            throw std::runtime_error("LevelManager: Unsupported level file version " + std::to_string(header.version) + ": " + path);
+        if (header.headerSize < sizeof(header) || header.headerSize > file->getSize() || header.nameLength > file->getSize() - header.headerSize)
+            throw std::runtime_error("LevelManager: Corrupt level header: " + path);
+        if (!isArrayInFile(header.xOffset, header.obstacleCount, file->getSize()) || !isArrayInFile(header.yOffset, header.obstacleCount, file->getSize()) ||
+            !isArrayInFile(header.chargeOffset, header.obstacleCount, file->getSize()) || !isArrayInFile(header.radiusOffset, header.obstacleCount, file->getSize()))
+            throw std::runtime_error("LevelManager: Corrupt obstacle arrays: " + path);
+
+        LevelData data;
+        data.name.assign(reinterpret_cast<const char *>(bytes + header.headerSize), header.nameLength);
+        data.size = sf::Vector2u(header.sizeX, header.sizeY);
+        data.playerStartPos = sf::Vector2f(header.playerStartX, header.playerStartY);
+        data.charges.view(file, header.obstacleCount,
+                          reinterpret_cast<const float *>(bytes + header.xOffset), reinterpret_cast<const float *>(bytes + header.yOffset),
+                          reinterpret_cast<const float *>(bytes + header.chargeOffset), reinterpret_cast<const float *>(bytes + header.radiusOffset));
+
+        // Nothing to parse, the pages are read when the arrays are first used
+        if (progress)
+        {
+            progress->totalBytes = file->getSize();
+            progress->loadedBytes = file->getSize();
+        }
+        return data;
+    }
+
+    // Write a JSON level file
+    void writeJsonLevel(const LevelData &data, const std::string &path)
+    {
+        // A new file is written and renamed over the old one, so a crash can't leave a half written level
+        const std::string temporaryPath = path + ".tmp";
+        std::ofstream levelFile(temporaryPath, std::ios::trunc);
         if (!levelFile)
-            throw std::runtime_error("LevelManager: Level load error: " + levelName + ".json");
+            throw std::runtime_error("LevelManager: Level save error: " + path);
 
-        // Deserialize it
+        // Write level data to json object
         nlohmann::json jsonData;
-        levelFile >> jsonData;
-
-        // Read name, size, playerStartPos and fill obstacles
-        std::string name = jsonData["name"];
-        sf::Vector2u size(jsonData["size"]["x"], jsonData["size"]["y"]);
-        
-        // Create obstacles to be filled
-        std::vector<std::shared_ptr<Obstacle>> obstacles;
-
-        // Auto because type names are confusing with this library
-        // Load fields of each obstacle into obstacle object
-        for (const auto &obstacleData : jsonData["obstacles"])
-        {
-            // Load fields
-            double charge = obstacleData["charge"];
-            sf::Vector2f position(obstacleData["position"]["x"], obstacleData["position"]["y"]);
-            double radius = obstacleData["radius"];
-            
-            // Construct obstacle object
-            Obstacle obstacle(radius, charge, position);
-            // Make shared pointer and push to obstacles
-            obstacles.push_back(std::make_shared<Obstacle>(obstacle));
-        }
-
-        // Load playerstartpos
-        sf::Vector2f playerStartPos(jsonData["playerStartPos"]["x"], jsonData["playerStartPos"]["y"]);
-        // Construct level and return it
-        return Level(levelName, size, obstacles, playerStartPos);
-    }
-    // If error occured throw runtime error
-    else
+        jsonData["name"] = data.name;
+        jsonData["size"]["x"] = data.size.x;
+        jsonData["size"]["y"] = data.size.y;
+        jsonData["playerStartPos"]["x"] = data.playerStartPos.x;
+        jsonData["playerStartPos"]["y"] = data.playerStartPos.y;
+
+        // Create json objects for every obstacle
+        // The collision radius is saved, the loader passes it to the obstacle constructor which scales the body from it
+        jsonData["obstacles"] = nlohmann::json::array();
+        for (size_t i = 0; i < data.charges.size(); i++)
+        {
+            nlohmann::json obstacleData;
+            obstacleData["charge"] = data.charges.getCharge()[i];
+            obstacleData["position"]["x"] = data.charges.getX()[i];
+            obstacleData["position"]["y"] = data.charges.getY()[i];
+            obstacleData["radius"] = data.charges.getCollisionRadius()[i];
+
+            jsonData["obstacles"].push_back(obstacleData);
+        }
+
+        // Write to file
+        levelFile << jsonData;
+        levelFile.close();
+        if (!levelFile)
+            throw std::runtime_error("LevelManager: Level save error: " + path);
+
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, path, error);
+        if (error)
+            throw std::runtime_error("LevelManager: Level save error: " + path);
+    }
+
+    // Round up to the alignment of the arrays of the binary format
+    uint64_t alignOffset(const uint64_t offset)
     {
-        throw std::runtime_error("LevelManager: Level not found: " + levelName + ".json");
+        return (offset + binaryLevelAlignment - 1) / binaryLevelAlignment * binaryLevelAlignment;
+    }
+
+    // Write a binary level file, floats are written in the byte order of the machine (little-endian on every supported platform)
+    // The file may be mapped by the level being saved, so a new file is written and renamed over it instead of truncating it
+    void writeBinaryLevel(const LevelData &data, const std::string &path)
+    {
+        const std::string temporaryPath = path + ".tmp";
+        std::ofstream levelFile(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!levelFile)
+            throw std::runtime_error("LevelManager: Level save error: " + path);
+
+        // Arrays follow the name, each aligned to a cache line
+        const uint64_t arrayBytes = data.charges.size() * sizeof(float);
+        BinaryLevelHeader header;
+        std::memcpy(header.magic, binaryLevelMagic, sizeof(binaryLevelMagic));
+        header.version = binaryLevelVersion;
+        header.headerSize = sizeof(header);
+        header.nameLength = static_cast<uint32_t>(data.name.size());
+        header.sizeX = data.size.x;
+        header.sizeY = data.size.y;
+        header.playerStartX = data.playerStartPos.x;
+        header.playerStartY = data.playerStartPos.y;
+        header.obstacleCount = data.charges.size();
+        header.xOffset = alignOffset(header.headerSize + header.nameLength);
+        header.yOffset = alignOffset(header.xOffset + arrayBytes);
+        header.chargeOffset = alignOffset(header.yOffset + arrayBytes);
+        header.radiusOffset = alignOffset(header.chargeOffset + arrayBytes);
+
+        levelFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        levelFile.write(data.name.data(), data.name.size());
+
+        // Pad up to the offset of every array, then write it
+        const std::pair<uint64_t, const float *> arrays[4] = {{header.xOffset, data.charges.getX()}, {header.yOffset, data.charges.getY()},
+                                                              {header.chargeOffset, data.charges.getCharge()}, {header.radiusOffset, data.charges.getCollisionRadius()}};
+        uint64_t written = header.headerSize + header.nameLength;
+        const char padding[binaryLevelAlignment] = {};
+        for (const auto &array : arrays)
+        {
+            levelFile.write(padding, array.first - written);
+            levelFile.write(reinterpret_cast<const char *>(array.second), arrayBytes);
+            written = array.first + arrayBytes;
+        }
+
+        levelFile.close();
+        if (!levelFile)
+            throw std::runtime_error("LevelManager: Level save error: " + path);
+
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, path, error);
+        if (error)
+            throw std::runtime_error("LevelManager: Level save error: " + path);
+    }
+
+    // Append an unsigned LEB128 varint, 7 bits per byte, lowest first
+    void writeVarint(std::vector<unsigned char> &out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<unsigned char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<unsigned char>(value));
+    }
+
+    // Read an unsigned LEB128 varint, checking the end of the payload
+    uint64_t readVarint(const unsigned char *&in, const unsigned char *end)
+    {
+        uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7)
+        {
+            if (in == end)
+                throw std::runtime_error("LevelManager: Truncated compressed level payload");
+            const unsigned char byte = *in++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+        throw std::runtime_error("LevelManager: Corrupt varint in compressed level payload");
+    }
+
+    // Zigzag coding maps small negative differences to small unsigned numbers
+    uint64_t encodeZigzag(const int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t decodeZigzag(const uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    // Write a compressed level file: palette, runs of palette indices and delta coded positions, compressed together
+    void writeCompressedLevel(const LevelData &data, const std::string &path)
+    {
+        const size_t count = data.charges.size();
+        const float *q = data.charges.getCharge();
+        const float *r = data.charges.getCollisionRadius();
+
+        // Palette of distinct (charge, radius) pairs, painted levels only have a handful
+        std::vector<std::pair<float, float>> palette;
+        std::unordered_map<uint64_t, uint32_t> paletteLookup;
+        std::vector<uint32_t> paletteIndex(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            uint32_t chargeBits;
+            uint32_t radiusBits;
+            std::memcpy(&chargeBits, &q[i], sizeof(chargeBits));
+            std::memcpy(&radiusBits, &r[i], sizeof(radiusBits));
+            const auto inserted = paletteLookup.emplace((static_cast<uint64_t>(chargeBits) << 32) | radiusBits, static_cast<uint32_t>(palette.size()));
+            if (inserted.second)
+                palette.emplace_back(q[i], r[i]);
+            paletteIndex[i] = inserted.first->second;
+        }
+
+        std::vector<unsigned char> payload;
+        payload.reserve(palette.size() * 8 + count * 4);
+        for (const std::pair<float, float> &entry : palette)
+        {
+            const float values[2] = {entry.first, entry.second};
+            payload.insert(payload.end(), reinterpret_cast<const unsigned char *>(values), reinterpret_cast<const unsigned char *>(values) + sizeof(values));
+        }
+        for (size_t i = 0; i < count;)
+        {
+            size_t run = 1;
+            while (i + run < count && paletteIndex[i + run] == paletteIndex[i])
+                run++;
+            writeVarint(payload, paletteIndex[i]);
+            writeVarint(payload, run);
+            i += run;
+        }
+        int64_t previousX = 0;
+        int64_t previousY = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            const int64_t x = std::llround(static_cast<double>(data.charges.getX()[i]) * compressedPositionScale);
+            const int64_t y = std::llround(static_cast<double>(data.charges.getY()[i]) * compressedPositionScale);
+            writeVarint(payload, encodeZigzag(x - previousX));
+            writeVarint(payload, encodeZigzag(y - previousY));
+            previousX = x;
+            previousY = y;
+        }
+        const std::vector<unsigned char> compressed = compressBytes(payload.data(), payload.size());
+
+        CompressedLevelHeader header;
+        std::memcpy(header.magic, compressedLevelMagic, sizeof(compressedLevelMagic));
+        header.version = compressedLevelVersion;
+        header.headerSize = sizeof(header);
+        header.nameLength = static_cast<uint32_t>(data.name.size());
+        header.sizeX = data.size.x;
+        header.sizeY = data.size.y;
+        header.playerStartX = data.playerStartPos.x;
+        header.playerStartY = data.playerStartPos.y;
+        header.obstacleCount = count;
+        header.paletteSize = static_cast<uint32_t>(palette.size());
+        header.positionScale = compressedPositionScale;
+        header.payloadSize = payload.size();
+        header.compressedSize = compressed.size();
+
+        // Written next to the old file and renamed over it, like the other formats
+        const std::string temporaryPath = path + ".tmp";
+        std::ofstream levelFile(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!levelFile)
+            throw std::runtime_error("LevelManager: Level save error: " + path);
+        levelFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        levelFile.write(data.name.data(), data.name.size());
+        levelFile.write(reinterpret_cast<const char *>(compressed.data()), compressed.size());
+        levelFile.close();
+        if (!levelFile)
+            throw std::runtime_error("LevelManager: Level save error: " + path);
+
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, path, error);
+        if (error)
+            throw std::runtime_error("LevelManager: Level save error: " + path);
+    }
+
+    // Read a compressed level file, the payload is decompressed at once and decoded in a single pass
+    LevelData readCompressedLevel(const std::string &path, LevelLoadProgress *progress)
+    {
+        const MappedFile file(path);
+        const unsigned char *bytes = file.getData();
+        if (progress)
+            progress->totalBytes = file.getSize();
+
+        // Validate header before trusting any size
+        CompressedLevelHeader header;
+        if (file.getSize() < sizeof(header))
+            throw std::runtime_error("LevelManager: Truncated level file: " + path);
+        std::memcpy(&header, bytes, sizeof(header));
+        if (std::memcmp(header.magic, compressedLevelMagic, sizeof(compressedLevelMagic)) != 0)
+            throw std::runtime_error("LevelManager: Not a compressed level file: " + path);
+        if (header.version == 0 || header.version > compressedLevelVersion)
+            throw std::runtime_error("LevelManager: Unsupported level file version " + std::to_string(header.version) + ": " + path);
+        if (header.headerSize < sizeof(header) || header.headerSize > file.getSize() || header.nameLength > file.getSize() - header.headerSize ||
+            header.compressedSize != file.getSize() - header.headerSize - header.nameLength || header.positionScale == 0)
+            throw std::runtime_error("LevelManager: Corrupt level header: " + path);
+
+        // The codec expands by at most 255 times, every obstacle takes at least 2 bytes of positions
+        if (header.payloadSize / 255 > header.compressedSize || header.obstacleCount > header.payloadSize / 2 ||
+            header.paletteSize > header.payloadSize / 8 || (header.obstacleCount != 0 && header.paletteSize == 0))
+            throw std::runtime_error("LevelManager: Corrupt level header: " + path);
+
+        std::vector<unsigned char> payload(header.payloadSize);
+        try
+        {
+            decompressBytes(bytes + header.headerSize + header.nameLength, header.compressedSize, payload.data(), payload.size());
+        }
+        catch (const std::runtime_error &e)
+        {
+            throw std::runtime_error("LevelManager: " + std::string(e.what()) + ": " + path);
+        }
+        if (progress)
+            progress->loadedBytes = file.getSize() / 2;
+
+        LevelData data;
+        data.name.assign(reinterpret_cast<const char *>(bytes + header.headerSize), header.nameLength);
+        data.size = sf::Vector2u(header.sizeX, header.sizeY);
+        data.playerStartPos = sf::Vector2f(header.playerStartX, header.playerStartY);
+
+        const unsigned char *in = payload.data();
+        const unsigned char *const end = payload.data() + payload.size();
+        // Charge and radius of every palette entry, one after the other
+        std::vector<float> palette(header.paletteSize * 2);
+        std::memcpy(palette.data(), in, palette.size() * sizeof(float));
+        in += palette.size() * sizeof(float);
+
+        // Expand the runs into the palette index of every obstacle
+        std::vector<uint32_t> paletteIndex;
+        paletteIndex.reserve(header.obstacleCount);
+        while (paletteIndex.size() < header.obstacleCount)
+        {
+            const uint64_t index = readVarint(in, end);
+            const uint64_t run = readVarint(in, end);
+            if (index >= header.paletteSize || run == 0 || run > header.obstacleCount - paletteIndex.size())
+                throw std::runtime_error("LevelManager: Corrupt charge runs: " + path);
+            paletteIndex.insert(paletteIndex.end(), run, static_cast<uint32_t>(index));
+        }
+
+        data.charges.reserve(header.obstacleCount);
+        const double scale = 1.0 / header.positionScale;
+        int64_t x = 0;
+        int64_t y = 0;
+        for (size_t i = 0; i < header.obstacleCount; i++)
+        {
+            x += decodeZigzag(readVarint(in, end));
+            y += decodeZigzag(readVarint(in, end));
+            data.charges.add(static_cast<float>(x * scale), static_cast<float>(y * scale), palette[paletteIndex[i] * 2], palette[paletteIndex[i] * 2 + 1]);
+        }
+        if (in != end)
+            throw std::runtime_error("LevelManager: Corrupt compressed level payload: " + path);
+
+        if (progress)
+            progress->loadedBytes = file.getSize();
+        return data;
+    }
+}
+
+// Read a level file, format chosen by extension
+LevelData LevelManager::readLevelFile(const std::string &path, LevelLoadProgress *progress)
+{
+    const std::string extension = std::filesystem::path(path).extension().string();
+    switch (getExtensionFormat(extension.empty() ? extension : extension.substr(1)))
+    {
+    case LevelFormat::Binary:
+        return readBinaryLevel(path, progress);
+    case LevelFormat::Compressed:
+        return readCompressedLevel(path, progress);
+    default:
+        return readJsonLevel(path, progress);
+    }
+}
+
+// Write a level file in the given format
+void LevelManager::writeLevelFile(const LevelData &data, const std::string &path, const LevelFormat format)
+{
+    switch (format)
+    {
+    case LevelFormat::Binary:
+        writeBinaryLevel(data, path);
+        break;
+    case LevelFormat::Compressed:
+        writeCompressedLevel(data, path);
+        break;
+    default:
+        writeJsonLevel(data, path);
+    }
+}
+
+// Find the file of a level in the catalog
+std::string LevelManager::findLevelFile(const std::string &levelName) const
+{
+    const LevelInfo *info = findLevelInfo(levelName);
+    if (info == nullptr)
+        throw std::runtime_error("LevelManager: Level not found: " + levelName);
+    return getLevelPath(levelName, info->format);
+}
+
+// Read a level file and replay its journal on top of it
+LevelData LevelManager::readSavedLevel(const std::string &levelName, const std::string &path, LevelLoadProgress *progress)
+{
+    LevelData data = readLevelFile(path, progress);
+    data.name = levelName;
+
+    std::ifstream journalFile(getJournalPath(levelName), std::ios::binary);
+    if (!journalFile)
+        return data;
+
+    // The journal only applies to the level file it was started on
+    LevelJournalHeader header;
+    if (!journalFile.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, levelJournalMagic, sizeof(levelJournalMagic)) != 0 || header.version != levelJournalVersion)
+    {
+        if (debug == 5)
+            std::cout << "Ignored invalid journal of level: " + levelName << std::endl;
+        return data;
+    }
+    {
+        MappedFile levelFile(path);
+        if (hashBytes(levelFile.getData(), levelFile.getSize()) != header.baseChecksum)
+        {
+            if (debug == 5)
+                std::cout << "Ignored outdated journal of level: " + levelName << std::endl;
+            return data;
+        }
+    }
+
+    // Apply records until the end of the journal or the first torn record
+    LevelJournalRecord record;
+    size_t recordCount = 0;
+    while (journalFile.read(reinterpret_cast<char *>(&record), sizeof(record)) && record.check == getRecordCheck(record))
+    {
+        if (record.type == LevelJournalRecordType::AddCharge)
+            data.charges.add(record.values[0], record.values[1], record.values[2], record.values[3]);
+        else if (record.type == LevelJournalRecordType::RemoveCharge && record.index < data.charges.size())
+            data.charges.remove(record.index);
+        else if (record.type == LevelJournalRecordType::SwapRemoveCharge && record.index < data.charges.size())
+            data.charges.swapRemove(record.index);
+        else if (record.type == LevelJournalRecordType::Level)
+        {
+            data.size = sf::Vector2u(static_cast<unsigned>(record.values[0]), static_cast<unsigned>(record.values[1]));
+            data.playerStartPos = sf::Vector2f(record.values[2], record.values[3]);
+        }
+        else
+            break;
+        recordCount++;
     }
     if (debug == 5)
-        std::cout << "Loaded level: " + levelName << std::endl;
+        std::cout << "Applied " << recordCount << " journal records to level: " + levelName << std::endl;
+    return data;
 }
 
-// Load level by index
-Level LevelManager::loadLevel(const size_t &levelIndex) const
+// Append the edits made since the level was last loaded or saved to its journal
+bool LevelManager::appendToJournal(const LevelData &data, LevelInfo &info)
 {
-    // Create level to be returned
-    Level retLevel;
-    // Catch errors occurring from overindexing, non-existent files etc...
-    // Return empty level if error occured
-    try
+    // The files have to hold an earlier revision of the same charges
+    std::vector<ChargeDelta> deltas;
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        const auto it = savedRevisions.find(data.name);
+        if (it == savedRevisions.end() || !data.charges.getDeltasSince(it->second, deltas))
+            return false;
+    }
+
+    // A journal which isn't a whole number of records ends with a torn record, records appended after it would be lost
+    const std::string journalPath = getJournalPath(data.name);
+    std::error_code error;
+    uintmax_t journalBytes = std::filesystem::file_size(journalPath, error);
+    if (error)
+        journalBytes = 0;
+    if (journalBytes != 0 && (journalBytes < sizeof(LevelJournalHeader) || (journalBytes - sizeof(LevelJournalHeader)) % sizeof(LevelJournalRecord) != 0))
+        return false;
+    const size_t recordCount = journalBytes == 0 ? 0 : (journalBytes - sizeof(LevelJournalHeader)) / sizeof(LevelJournalRecord);
+    if (recordCount + deltas.size() + 1 > levelJournalLimit)
+        return false;
+
+    // An existing journal has to belong to the current level file
+    if (journalBytes != 0)
+    {
+        LevelJournalHeader header;
+        std::ifstream journalFile(journalPath, std::ios::binary);
+        if (!journalFile.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.baseChecksum != info.checksum)
+            return false;
+    }
+
+    std::ofstream journalFile(journalPath, std::ios::binary | std::ios::app);
+    if (!journalFile)
+        return false;
+    if (journalBytes == 0)
     {
-        retLevel = loadLevel(loadables.at(levelIndex));
+        LevelJournalHeader header;
+        std::memcpy(header.magic, levelJournalMagic, sizeof(levelJournalMagic));
+        header.version = levelJournalVersion;
+        header.baseChecksum = info.checksum;
+        journalFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
     }
-    catch (const std::exception &e)
+
+    // One record for every edit of the charges, then one for the rest of the level
+    LevelJournalRecord record;
+    for (const ChargeDelta &delta : deltas)
+    {
+        if (delta.type == ChargeDelta::Type::Add)
+            record.type = LevelJournalRecordType::AddCharge;
+        else
+            record.type = delta.type == ChargeDelta::Type::Remove ? LevelJournalRecordType::RemoveCharge : LevelJournalRecordType::SwapRemoveCharge;
+        record.index = static_cast<uint32_t>(delta.index);
+        record.values[0] = delta.x;
+        record.values[1] = delta.y;
+        record.values[2] = delta.q;
+        record.values[3] = delta.collisionRadius;
+        record.check = getRecordCheck(record);
+        journalFile.write(reinterpret_cast<const char *>(&record), sizeof(record));
+    }
+    record.type = LevelJournalRecordType::Level;
+    record.index = 0;
+    record.values[0] = static_cast<float>(data.size.x);
+    record.values[1] = static_cast<float>(data.size.y);
+    record.values[2] = data.playerStartPos.x;
+    record.values[3] = data.playerStartPos.y;
+    record.check = getRecordCheck(record);
+    journalFile.write(reinterpret_cast<const char *>(&record), sizeof(record));
+
+    // A failed append leaves a torn journal, the level file is then written in full which deletes it
+    journalFile.close();
+    if (!journalFile)
+        return false;
+    info.journalSize = (journalBytes == 0 ? sizeof(LevelJournalHeader) : journalBytes) + (deltas.size() + 1) * sizeof(LevelJournalRecord);
+
+    // Grow the bounding box by the added charges, it isn't shrunk by removals until the next full write
+    uint64_t obstacleCount = info.obstacleCount;
+    for (const ChargeDelta &delta : deltas)
     {
-        std::cerr << e.what() << '\n';
-        return Level();
+        if (delta.type != ChargeDelta::Type::Add)
+        {
+            obstacleCount--;
+            continue;
+        }
+        info.minX = obstacleCount == 0 ? delta.x : std::min(info.minX, delta.x);
+        info.minY = obstacleCount == 0 ? delta.y : std::min(info.minY, delta.y);
+        info.maxX = obstacleCount == 0 ? delta.x : std::max(info.maxX, delta.x);
+        info.maxY = obstacleCount == 0 ? delta.y : std::max(info.maxY, delta.y);
+        obstacleCount++;
     }
-    return retLevel;
+    info.obstacleCount = data.charges.size();
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    savedRevisions[data.name] = data.charges.getRevision();
+    return true;
 }
 
-// This function saves the given level object to a JSON file.
-void LevelManager::saveLevel(const Level &level)
+// Counters of the cache
+LevelCacheStats LevelManager::getCacheStats() const
 {
-    // Open the file for writing
-    std::ofstream levelFile("./levels/" + level.getName() + ".json");
-    if (!levelFile)
-        throw std::runtime_error("LevelManager: Level save error: " + level.getName() + ".json");
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return cacheStats;
+}
 
-    // Write level data to json object
-    nlohmann::json jsonData;
-    jsonData["name"] = level.getName();
-    jsonData["size"]["x"] = level.getSize().x;
-    jsonData["size"]["y"] = level.getSize().y;
-    jsonData["playerStartPos"]["x"] = level.getPlayerStartPos().x;
-    jsonData["playerStartPos"]["y"] = level.getPlayerStartPos().y;
+// Memory used by the cached levels
+size_t LevelManager::getCacheBytes() const
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return cacheBytes;
+}
+
+// Look up a level in the cache, drop it if its file changed
+std::shared_ptr<const LevelData> LevelManager::findCached(const std::string &levelName, const std::string &path) const
+{
+    std::error_code error;
+    const std::filesystem::file_time_type modified = std::filesystem::last_write_time(path, error);
 
-    // Create json objects for every obstacle
-    for (const auto &obstacle : level.getObstacles())
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cacheIndex.find(levelName);
+    if (it == cacheIndex.end())
     {
-        nlohmann::json obstacleData;
-        obstacleData["charge"] = obstacle.get()->getElectricCharge();
-        obstacleData["position"]["x"] = obstacle.get()->getBody()->getPosition().x;
-        obstacleData["position"]["y"] = obstacle.get()->getBody()->getPosition().y;
-        obstacleData["radius"] = obstacle.get()->getBody()->getRadius();
+        cacheStats.misses++;
+        return nullptr;
+    }
 
-        jsonData["obstacles"].push_back(obstacleData);
+    // Saved in the other format or modified from outside since it was cached
+    if (error || it->second->path != path || it->second->modified != modified)
+    {
+        cacheBytes -= it->second->bytes;
+        cache.erase(it->second);
+        cacheIndex.erase(it);
+        cacheStats.misses++;
+        return nullptr;
     }
 
-    // Write to file
-    levelFile << jsonData;
+    // Move to the front of the recently used list
+    cache.splice(cache.begin(), cache, it->second);
+    cacheStats.hits++;
+    return it->second->snapshot;
+}
 
-    // Add level name to loadables if it is not already present
-    if (std::find(loadables.begin(), loadables.end(), level.getName()) == loadables.end())
-        loadables.push_back(level.getName());
+// Cache a loaded level, evict least recently used levels over the budget
+std::shared_ptr<const LevelData> LevelManager::addToCache(const std::string &path, LevelData &&data) const
+{
+    std::shared_ptr<const LevelData> snapshot = std::make_shared<const LevelData>(std::move(data));
+    const size_t bytes = sizeof(LevelData) + snapshot->name.size() + snapshot->charges.size() * 4 * sizeof(float);
+    if (bytes > levelCacheBudget)
+        return snapshot;
 
-    if (debug == 5)
-        std::cout << "Saved level: " + level.getName() << std::endl;
+    std::error_code error;
+    const std::filesystem::file_time_type modified = std::filesystem::last_write_time(path, error);
+    if (error)
+        return snapshot;
 
-    levelFile.close();
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    // Replace an older copy, another thread might have loaded the same level
+    auto it = cacheIndex.find(snapshot->name);
+    if (it != cacheIndex.end())
+    {
+        cacheBytes -= it->second->bytes;
+        cache.erase(it->second);
+        cacheIndex.erase(it);
+    }
+
+    while (!cache.empty() && cacheBytes + bytes > levelCacheBudget)
+    {
+        cacheBytes -= cache.back().bytes;
+        cacheIndex.erase(cache.back().name);
+        cache.pop_back();
+        cacheStats.evictions++;
+    }
+
+    cache.push_front(CachedLevel{snapshot->name, path, modified, snapshot, bytes});
+    cacheIndex[snapshot->name] = cache.begin();
+    cacheBytes += bytes;
+    return snapshot;
+}
+
+// Drop a level from the cache
+void LevelManager::invalidateCached(const std::string &levelName)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cacheIndex.find(levelName);
+    if (it == cacheIndex.end())
+        return;
+    cacheBytes -= it->second->bytes;
+    cache.erase(it->second);
+    cacheIndex.erase(it);
+}
+
+// Level data whose charge store views the arrays of the snapshot, the first edit copies them
+LevelData LevelManager::handOut(const std::shared_ptr<const LevelData> &snapshot) const
+{
+    LevelData data;
+    data.name = snapshot->name;
+    data.size = snapshot->size;
+    data.playerStartPos = snapshot->playerStartPos;
+    const ChargeStore &charges = snapshot->charges;
+    data.charges.view(snapshot, charges.size(), charges.getX(), charges.getY(), charges.getCharge(), charges.getCollisionRadius());
+
+    // The files hold this revision, edits made to it can be journaled
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    savedRevisions[data.name] = data.charges.getRevision();
+    return data;
+}
+
+// Loads the contents of a level by name, from the cache if it is still up to date
+LevelData LevelManager::loadLevelData(const std::string &levelName) const
+{
+    const std::string path = findLevelFile(levelName);
+    std::shared_ptr<const LevelData> snapshot = findCached(levelName, path);
+    if (!snapshot)
+    {
+        LevelData data = readSavedLevel(levelName, path, nullptr);
+        snapshot = addToCache(path, std::move(data));
+        if (debug == 5)
+            std::cout << "Loaded level: " + levelName << std::endl;
+    }
+    else if (debug == 5)
+        std::cout << "Loaded level from cache: " + levelName << std::endl;
+
+    return handOut(snapshot);
+}
+
+// Load the contents of a level on a new thread, the index is only read by the calling thread
+std::future<LevelData> LevelManager::loadLevelDataAsync(const std::string &levelName, const std::shared_ptr<LevelLoadProgress> &progress) const
+{
+    std::string path;
+    std::promise<LevelData> immediate;
+    try
+    {
+        path = findLevelFile(levelName);
+
+        // Cached levels are ready at once
+        const std::shared_ptr<const LevelData> snapshot = findCached(levelName, path);
+        if (snapshot)
+        {
+            if (progress)
+            {
+                progress->totalBytes = 1;
+                progress->loadedBytes = 1;
+            }
+            immediate.set_value(handOut(snapshot));
+            return immediate.get_future();
+        }
+    }
+    catch (const std::exception &)
+    {
+        // Errors are reported through the future like the ones of the loading thread
+        immediate.set_exception(std::current_exception());
+        return immediate.get_future();
+    }
+
+    return std::async(std::launch::async, [this, path, levelName, progress]()
+                      {
+        LevelData data = readSavedLevel(levelName, path, progress.get());
+        if (debug == 5)
+            std::cout << "Loaded level in the background: " + levelName << std::endl;
+        return handOut(addToCache(path, std::move(data))); });
+}
+
+// This function saves the given level data in the given format.
+void LevelManager::saveLevel(const LevelData &data, const LevelFormat format)
+{
+    // Copies of the cached level handed out earlier keep their arrays
+    invalidateCached(data.name);
+
+    // A few edits of a level saved in the same format are only appended to its journal
+    ensureCatalog();
+    const auto saved = catalogIndex.find(data.name);
+    if (saved != catalogIndex.end() && catalog[saved->second].format == format && appendToJournal(data, catalog[saved->second]))
+    {
+        isCatalogChanged = true;
+        updateIndex();
+        if (debug == 5)
+            std::cout << "Saved level to its journal: " + data.name << std::endl;
+        return;
+    }
+
+    const std::string path = getLevelPath(data.name, format);
+    writeLevelFile(data, path, format);
+
+    // The journal holds edits of the old level file, it is deleted after the new file is complete
+    // If this doesn't happen because of a crash, the journal is ignored as its checksum doesn't match the new file
+    std::error_code error;
+    std::filesystem::remove(getJournalPath(data.name), error);
+
+    // Remove the files in the other formats, they belong to an older version of the level
+    for (const LevelFormat otherFormat : {LevelFormat::Json, LevelFormat::Binary, LevelFormat::Compressed})
+        if (otherFormat != format)
+            std::filesystem::remove(getLevelPath(data.name, otherFormat), error);
+
+    // Update the catalog entry of the level, or add one at the end if it is new
+    const LevelInfo info = describeLevel(data, path, format);
+    const auto it = catalogIndex.find(data.name);
+    if (it == catalogIndex.end())
+    {
+        catalogIndex[data.name] = catalog.size();
+        catalog.push_back(info);
+    }
+    else
+        catalog[it->second] = info;
+    isCatalogChanged = true;
+    updateIndex();
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        savedRevisions[data.name] = data.charges.getRevision();
+    }
+
+    if (debug == 5)
+        std::cout << "Saved level: " + data.name << std::endl;
 }
 
 // Delete a level by providing level name
 const bool LevelManager::deleteLevel(const std::string &levelName)
 {
-    // Look for levelName in loadables with iterator
-    // Auto because of complicated type name of iterators
-    auto it = std::find(loadables.begin(), loadables.end(), levelName);
+    // Look for levelName in the catalog
+    ensureCatalog();
+    const auto it = catalogIndex.find(levelName);
 
-    // If end was reached without finding the level return false
-    if (it == loadables.end())
+    // If the level is not in the catalog return false
+    if (it == catalogIndex.end())
     {
         return false;
     }
 
-    // Remove levelName from loadables
-    loadables.erase(it);
+    // Remove the level from the catalog, later levels move one position forward
+    const size_t position = it->second;
+    catalogIndex.erase(it);
+    catalog.erase(catalog.begin() + position);
+    for (size_t i = position; i < catalog.size(); i++)
+        catalogIndex[catalog[i].name] = i;
+    isCatalogChanged = true;
+    updateIndex();
+    invalidateCached(levelName);
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        savedRevisions.erase(levelName);
+    }
+    std::error_code journalError;
+    std::filesystem::remove(getJournalPath(levelName), journalError);
 
-    // Delete the corresponding JSON file
-    std::string filePath = "./levels/" + levelName + ".json";
-    if (std::remove(filePath.c_str()) != 0) {
-        throw std::runtime_error("LevelManager: Failed to delete level file: " + levelName + ".json");
+    // Delete the corresponding file in whichever format it was saved
+    std::error_code error;
+    bool isRemoved = false;
+    for (const LevelFormat format : {LevelFormat::Json, LevelFormat::Binary, LevelFormat::Compressed})
+        isRemoved |= std::filesystem::remove(getLevelPath(levelName, format), error);
+    if (!isRemoved) {
+        throw std::runtime_error("LevelManager: Failed to delete level file: " + levelName);
     }
 
     return true;
@@ -7,14 +7,21 @@
 #include <exception>
 #include <thread>
 #include <chrono>
+#include <future>
+#include <string>
 
 #include "obstacle.h"
 #include "player.h"
 #include "charge.h"
 #include "level.h"
+#include "chargeStore.h"
 #include "levelManager.h"
 #include "settings.h"
 #include "physics.h"
+#include "thumbnailCache.h"
+#include "obstacleRenderer.h"
+#include "fieldOverlay.h"
+#include "fieldLineTracer.h"
 
 extern const char debug;
 extern const unsigned int targetFramerate;
@@ -23,6 +30,8 @@ extern const unsigned windowHeight;
 extern const float arrowWidth;
 extern const unsigned menuTitleSize;
 extern const unsigned levelNameCharLimit;
+extern const float simulationTimeStep;
+extern const unsigned maxSimulationStepsPerFrame;
 
 /**
  * @brief The main window of the application.
@@ -68,6 +77,33 @@ Level level;
  */
 std::vector<std::shared_ptr<sf::Drawable>> gameDrawables;
 
+/**
+ * @brief Draws the obstacles of the level in a few draw calls, it is in gameDrawables after the player.
+ *
+ * It is rebuilt from the charges of the level every frame by render().
+ */
+std::shared_ptr<ObstacleRenderer> obstacleRenderer(std::make_shared<ObstacleRenderer>());
+
+/**
+ * @brief Shows the potential and the field strength of the obstacles under the game items, toggled with F.
+ */
+FieldOverlay fieldOverlay;
+
+/**
+ * @brief Whether the field overlay is shown.
+ */
+bool isFieldOverlay = false;
+
+/**
+ * @brief Traces the field lines of the obstacles in the background, toggled with L.
+ */
+FieldLineTracer fieldLines;
+
+/**
+ * @brief Whether the field lines are shown.
+ */
+bool isFieldLines = false;
+
 /**
  * @brief A vector of pointers to constant sf::Drawable objects.
  *
@@ -100,13 +136,21 @@ bool isPause = false;
 bool isEditorMode = false;
 
 /**
- * @brief The time elapsed since the last simulation iteration.
+ * @brief The time elapsed since the last rendered frame.
  *
  * This variable represents the time difference between the current iteration and the previous iteration.
- * It is used to control the speed of the physics simulation.
+ * It is added to the simulation accumulator, which is consumed in fixed physics steps.
  */
 float deltaTime = 0.0f;
 
+/**
+ * @brief The time elapsed but not simulated yet.
+ *
+ * Physics runs in steps of simulationTimeStep, the remainder is carried over to the next frame
+ * and used to interpolate the drawn position of the player.
+ */
+float simulationAccumulator = 0.0f;
+
 /**
  * @class PhysicsEngine
  * @brief Represents a physics engine for simulating physical interactions.
@@ -115,6 +159,13 @@ float deltaTime = 0.0f;
  */
 PhysicsEngine physics;
 
+/**
+ * @brief The previews of the levels shown in the main menu.
+ *
+ * The previews are made on a background thread and kept for the whole run, so returning to the menu shows them at once.
+ */
+ThumbnailCache thumbnails;
+
 /**
  * @brief The `sf::Font` class is a utility class for loading and using fonts.
  *
@@ -122,6 +173,13 @@ PhysicsEngine physics;
  */
 sf::Font font;
 
+/**
+ * @brief Whether the shown menu changed since it was last drawn.
+ *
+ * Menus only draw a frame if something changed, it is set after changing a menu item or resizing the window.
+ */
+bool isMenuDirty = true;
+
 // Declaration of functions
 void runGame();
 void resizeView(const sf::Vector2u &newSize);
@@ -191,6 +249,12 @@ void handleGameEvent()
             // Escape pauses
             if (evnt.key.code == sf::Keyboard::Escape)
                 isPause = !isPause;
+            // F toggles the field overlay
+            if (evnt.key.code == sf::Keyboard::F)
+                isFieldOverlay = !isFieldOverlay;
+            // L toggles the field lines
+            if (evnt.key.code == sf::Keyboard::L)
+                isFieldLines = !isFieldLines;
             // R resets based on modifyer keys
             if (evnt.key.code == sf::Keyboard::R)
             {
@@ -211,38 +275,40 @@ void handleGameEvent()
 }
 
 /**
- * @brief Handles menu events.
+ * @brief Handles a menu event.
  *
- * This function is responsible for handling events related to the menu.
- * It listens for events such as window close and key press.
+ * This function is responsible for handling events common to the menus, such as window close and key press.
  * If the window is closed, it clears the obstacles, game drawables, and menu drawables.
  * It also closes the window and exits the program. If the escape key is pressed, it toggles the pause state.
+ *
+ * @param evnt The event to handle.
  */
-void handleMenuEvent()
+void handleMenuEvent(const sf::Event &evnt)
 {
-    // Poll for events
-    sf::Event evnt;
-    while (window.pollEvent(evnt))
+    switch (evnt.type)
     {
-        switch (evnt.type)
-        {
-            // Close event
-        case sf::Event::Closed:
-            level.clearObstacles();
-            gameDrawables.clear();
-            menuDrawables.clear();
-            window.close();
-            exit(0);
-            break;
-            // Resize must be handled by menu functions because of unique text layout!
-
-            // For unpausing the pause menu
-        case sf::Event::KeyPressed:
-            if (evnt.key.code == sf::Keyboard::Escape)
-                isPause = !isPause;
-        default:
-            break;
-        }
+        // Close event
+    case sf::Event::Closed:
+        level.clearObstacles();
+        gameDrawables.clear();
+        menuDrawables.clear();
+        window.close();
+        exit(0);
+        break;
+        // Resize must be handled by menu functions because of unique text layout!
+
+        // The window may have been covered, draw it again
+    case sf::Event::GainedFocus:
+        isMenuDirty = true;
+        break;
+
+        // For unpausing the pause menu
+    case sf::Event::KeyPressed:
+        if (evnt.key.code == sf::Keyboard::Escape)
+            isPause = !isPause;
+        break;
+    default:
+        break;
     }
 }
 
@@ -285,25 +351,17 @@ void handleEditorModeInput()
         // If LCtrl modifier key is pressed: places negative charge
         if (sf::Keyboard::isKeyPressed(sf::Keyboard::LControl))
         {
-            // Create obstacle and add to level, push to drawables.
+            // Create obstacle and add to level, the obstacle renderer picks it up from the charges of the level
             std::shared_ptr<Obstacle> newObstacle(std::make_shared<Obstacle>(7.0f, -1500.0f, mousePos));
             level.addObstacle(newObstacle);
-
-            gameDrawables.push_back(newObstacle->getBody());
         }
         // If LAlt modifier key is pressed: removes obstacles the mouse touches
         else if (sf::Keyboard::isKeyPressed(sf::Keyboard::LAlt))
         {
-            // Check for each obstacle if mouse is touching
-            for (size_t i = 0; i < level.getObstacles().size(); i++)
-            {
-                // If touching, remove from obstacles and drawables
-                if (level.getObstacles()[i]->getBody()->getGlobalBounds().contains(mousePos.x, mousePos.y))
-                {
-                    level.removeObstacle(i);
-                    gameDrawables.erase(gameDrawables.begin() + i + 1);
-                }
-            }
+            // Only the obstacles hashed near the mouse are tested, the touched ones are removed in one batch
+            std::vector<size_t> touched;
+            level.findObstacles(mousePos, 0.0f, touched);
+            level.removeObstacles(touched);
         }
     }
     // Right click: If LCtrl modifier key is pressed places positive charge
@@ -314,10 +372,9 @@ void handleEditorModeInput()
         mousePos.x = sf::Mouse::getPosition(window).x;
         mousePos.y = sf::Mouse::getPosition(window).y;
 
-        // Create obstacle and add to level, push to drawables.
+        // Create obstacle and add to level, the obstacle renderer picks it up from the charges of the level
         std::shared_ptr<Obstacle> newObstacle(std::make_shared<Obstacle>(7.0, 1500.0f, mousePos));
         level.addObstacle(newObstacle);
-        gameDrawables.push_back(newObstacle->getBody());
     }
 }
 
@@ -332,6 +389,24 @@ void render()
     // Clear window
     window.clear(sf::Color::Black);
 
+    // Rebuild the quads of the obstacles while a level is shown, the charges may have been edited and the player has moved
+    if (!gameDrawables.empty())
+        obstacleRenderer->update(level.getCharges(), player.getBody()->getPosition());
+
+    // Draw the field overlay under the game items, only the edits since the last frame are summed
+    if (isFieldOverlay && !gameDrawables.empty())
+    {
+        fieldOverlay.update(level.getCharges(), level.getSize());
+        window.draw(fieldOverlay);
+    }
+
+    // Draw the latest traced field lines, a new trace is started in the background if the level changed
+    if (isFieldLines && !gameDrawables.empty())
+    {
+        fieldLines.update(level.getCharges(), level.getSize());
+        window.draw(fieldLines);
+    }
+
     // Draw game items
     for (const std::shared_ptr<sf::Drawable> &drawablePtr : gameDrawables)
         window.draw(*drawablePtr);
@@ -355,6 +430,37 @@ void render()
     window.display();
 }
 
+/**
+ * @brief Renders the window if the shown menu changed since it was last drawn.
+ */
+void renderMenu()
+{
+    if (!isMenuDirty)
+        return;
+    render();
+    isMenuDirty = false;
+}
+
+/**
+ * @brief Waits for the next event of a menu.
+ *
+ * Without background work the thread sleeps until an event arrives, so an idle menu uses no CPU.
+ * With background work the function returns after menuPollInterval, so the menu can show its progress.
+ *
+ * @param evnt The event is written here.
+ * @param isBusy Whether the menu waits for background work.
+ * @return True if an event was received.
+ */
+bool waitMenuEvent(sf::Event &evnt, const bool isBusy)
+{
+    if (!isBusy)
+        return window.waitEvent(evnt);
+    if (window.pollEvent(evnt))
+        return true;
+    std::this_thread::sleep_for(menuPollInterval);
+    return false;
+}
+
 /**
  * @brief Sets the start speed of the player based on the user's input.
  *
@@ -431,16 +537,25 @@ void setStartSpeed()
     player.setSpeed(startSpeed);
 }
 
-void updateObstacles()
+// Run method with game loop
+/**
+ * @brief Advances the player by one simulation step.
+ *
+ * The physics engine is bound to the charges and the size of the current level (the size can change in editor mode),
+ * the game is paused if the player hits an obstacle.
+ *
+ * @param timeStep The simulated time of the step in seconds.
+ */
+void updatePlayer(const float timeStep)
 {
-    // Update obstacles vector to player and animation
-    for (size_t i = 0; i < level.getObstacles().size(); i++)
-    {
-        level.getObstacles()[i]->updateObstacle();
-    }
+    physics.setCharges(level.getCharges(), level.getSize());
+
+    PlayerState state = player.getState();
+    if (physics.step(state, timeStep))
+        isPause = true;
+    player.updateMovement(state);
 }
 
-// Run method with game loop
 /**
  * @brief Runs the game loop.
  *
@@ -453,6 +568,7 @@ void runGame()
 {
     // Restart game clock measuring deltaTime between iterations of simulation cycles
     gameClock.restart();
+    simulationAccumulator = 0.0f;
 
     // Game loop
     while (window.isOpen())
@@ -468,6 +584,8 @@ void runGame()
         }
         // Set deltaTime
         deltaTime = gameClock.restart().asSeconds();
+        if (debug == 1)
+            std::cout << "dT:\t" << deltaTime << std::endl;
 
         // Handle events
         handleGameEvent();
@@ -476,10 +594,20 @@ void runGame()
         if (isEditorMode)
             handleEditorModeInput();
 
-        // Run iteration of physics simulation
-        physics.updatePlayer();
+        // Run as many fixed physics steps as fit into the elapsed time, stop early on collision
+        simulationAccumulator += deltaTime;
+        unsigned steps = 0;
+        while (simulationAccumulator >= simulationTimeStep && steps < maxSimulationStepsPerFrame && !isPause)
+        {
+            updatePlayer(simulationTimeStep);
+            simulationAccumulator -= simulationTimeStep;
+            steps++;
+        }
+        // Drop time that couldn't be simulated in this frame (or while paused) instead of catching up later
+        simulationAccumulator = std::min(simulationAccumulator, simulationTimeStep);
 
-        updateObstacles();
+        // Draw player between the last two steps
+        player.interpolate(simulationAccumulator / simulationTimeStep);
 
         // Render drawables
         render();
@@ -518,12 +646,14 @@ void startGame()
     player.setPosition(playerStartPos);
     gameDrawables.clear();
     menuDrawables.clear();
-    // Player is first in drawables, then all obstacles are pushed
+    // Player is first in drawables, then the obstacles are drawn together by the obstacle renderer
     gameDrawables.push_back(player.getBody());
-    for (const std::shared_ptr<Obstacle> &obstacle : level.getObstacles())
-    {
-        gameDrawables.push_back(obstacle->getBody());
-    }
+    gameDrawables.push_back(obstacleRenderer);
+    // Build data structures of the physics solver (quadtree or field grid) for the new level
+    physics.setCharges(level.getCharges(), level.getSize());
+    physics.setPlayerTraits(player.getTraits());
+    physics.prepare();
+
     // Default is unpaused
     isPause = false;
     setStartSpeed();
@@ -570,151 +700,273 @@ void runMainMenu()
     menuItemTemplate.setCharacterSize(20);
     menuItemTemplate.setFillColor(sf::Color::White);
 
-    // Get loadable level names
-    const std::vector<std::string> &levels = LevelManager::getInstance()->getLoadables();
-
-    // Create menu items for each level
-    for (size_t i = 0; i < std::min(levels.size(), size_t(6)); i++)
+    // Create menu items of the grid, their names are set by showPage
+    for (size_t i = 0; i < menuPageSize; i++)
     {
         std::shared_ptr<sf::Text> menuItem = std::make_shared<sf::Text>(menuItemTemplate);
-        menuItem->setString(levels[i]);
-        menuItem->setOrigin(menuItem->getGlobalBounds().width / 2.0f, menuItem->getGlobalBounds().height / 2.0f);
-        menuItem->setPosition((windowWidth - 3 * 200) / 2.0f + 100 + (i % 3 * 200), windowHeight / 2.0f + (i / 3) * 50);
         menuItems.push_back(menuItem);
     }
 
-    // Fill the rest of the grid with empty slots
-    for (size_t i = levels.size(); i < 6; i++)
+    // Create page navigation, the catalog can hold far more levels than fit in the grid
+    std::shared_ptr<sf::Text> previousPageOption = std::make_shared<sf::Text>(sf::Text("<", font));
+    previousPageOption->setCharacterSize(20);
+    previousPageOption->setFillColor(sf::Color::White);
+    menuDrawables.push_back(previousPageOption);
+    std::shared_ptr<sf::Text> nextPageOption = std::make_shared<sf::Text>(sf::Text(">", font));
+    nextPageOption->setCharacterSize(20);
+    nextPageOption->setFillColor(sf::Color::White);
+    menuDrawables.push_back(nextPageOption);
+    std::shared_ptr<sf::Text> pageText = std::make_shared<sf::Text>(sf::Text("", font));
+    pageText->setCharacterSize(20);
+    pageText->setFillColor(sf::Color::White);
+    menuDrawables.push_back(pageText);
+
+    // Create a preview above every menu item, its texture is filled in once the preview is ready
+    std::vector<std::shared_ptr<sf::Sprite>> thumbnailSprites;
+    std::vector<sf::Texture> thumbnailTextures(menuPageSize);
+    std::vector<std::shared_ptr<const Thumbnail>> shownThumbnails(menuPageSize);
+    for (size_t i = 0; i < menuPageSize; i++)
     {
-        std::shared_ptr<sf::Text> menuItem = std::make_shared<sf::Text>(menuItemTemplate);
-        menuItem->setOrigin(menuItem->getGlobalBounds().width / 2.0f, menuItem->getGlobalBounds().height / 2.0f);
-        // Setup grid for levels
-        menuItem->setPosition((windowWidth - 3 * 200) / 2.0f + 100 + (i % 3 * 200), windowHeight / 2.0f + (i / 3) * 50);
-        menuItems.push_back(menuItem);
+        std::shared_ptr<sf::Sprite> thumbnailSprite = std::make_shared<sf::Sprite>();
+        thumbnailSprites.push_back(thumbnailSprite);
+        menuDrawables.push_back(thumbnailSprite);
     }
 
+    // Fill the grid with the names of one page of levels, only those names are read from the catalog
+    // The last page always has an empty slot for a new level
+    size_t page = 0;
+    auto showPage = [&]()
+    {
+        const size_t levelCount = LevelManager::getInstance()->getLevelCount();
+        const size_t pageCount = levelCount / menuPageSize + 1;
+        page = std::min(page, pageCount - 1);
+        for (size_t i = 0; i < menuItems.size(); i++)
+        {
+            const size_t levelIndex = page * menuPageSize + i;
+            menuItems[i]->setString(levelIndex < levelCount ? LevelManager::getInstance()->getLevelInfo(levelIndex).name : "Empty Slot");
+            menuItems[i]->setOrigin(menuItems[i]->getGlobalBounds().width / 2.0f, menuItems[i]->getGlobalBounds().height / 2.0f);
+            // Setup grid for levels, the previews are above the names
+            menuItems[i]->setPosition((window.getSize().x - 3 * 200) / 2.0f + 100 + (i % 3 * 200), window.getSize().y / 2.0f + (i / 3) * 80);
+            thumbnailSprites[i]->setPosition(menuItems[i]->getPosition().x, menuItems[i]->getPosition().y - 14.0f);
+
+            // Hidden until the preview of the level in the slot is ready
+            thumbnailSprites[i]->setColor(sf::Color::Transparent);
+            shownThumbnails[i] = nullptr;
+        }
+        pageText->setString("Page " + std::to_string(page + 1) + " / " + std::to_string(pageCount));
+        pageText->setOrigin(pageText->getLocalBounds().width / 2.0f, pageText->getLocalBounds().height / 2.0f);
+        pageText->setPosition(window.getSize().x / 2.0f, window.getSize().y / 2.0f + 130.0f);
+        previousPageOption->setPosition(window.getSize().x / 2.0f - 150.0f, window.getSize().y / 2.0f + 120.0f);
+        nextPageOption->setPosition(window.getSize().x / 2.0f + 140.0f, window.getSize().y / 2.0f + 120.0f);
+    };
+    showPage();
+
     // Push every menu item to drawables
     for (const std::shared_ptr<sf::Text> &menuItem : menuItems)
     {
         menuDrawables.push_back(menuItem);
     }
 
-    // Menu loop for
+    // Create loading text, empty until a level is being loaded
+    std::shared_ptr<sf::Text> loadingText = std::make_shared<sf::Text>(sf::Text("", font));
+    loadingText->setFillColor(sf::Color::Green);
+    loadingText->setCharacterSize(20);
+    loadingText->setPosition(window.getSize().x / 2.0f, window.getSize().y - 30.0f);
+    menuDrawables.push_back(loadingText);
+
+    // The level is loaded in the background, so the menu keeps rendering and handling events
+    std::future<LevelData> pendingLevel;
+    std::shared_ptr<LevelLoadProgress> loadProgress;
+    std::string pendingLevelName;
+
+    // Show the previews of the visible levels once the background thread made them
+    // Returns whether a visible level has no preview yet
+    auto showThumbnails = [&]()
+    {
+        bool isWaiting = false;
+        for (size_t i = 0; i < menuItems.size(); i++)
+        {
+            const LevelInfo *info = LevelManager::getInstance()->findLevelInfo(menuItems[i]->getString());
+            if (info == nullptr)
+                continue;
+            const std::shared_ptr<const Thumbnail> image = thumbnails.request(*info);
+            if (!image)
+                isWaiting = true;
+            if (!image || image == shownThumbnails[i])
+                continue;
+            thumbnailTextures[i].create(image->width, image->height);
+            thumbnailTextures[i].update(image->pixels.data());
+            thumbnailSprites[i]->setTexture(thumbnailTextures[i], true);
+            thumbnailSprites[i]->setOrigin(image->width / 2.0f, image->height);
+            thumbnailSprites[i]->setColor(sf::Color::White);
+            shownThumbnails[i] = image;
+            isMenuDirty = true;
+        }
+        return isWaiting;
+    };
+
+    // Menu loop, a frame is only drawn if something changed
     bool isDeleteMode = false;
+    isMenuDirty = true;
     while (window.isOpen())
     {
-        render();
-        if (debug == 6)
-            for (size_t i = 0; i < menuItems.size(); i++)
-            {
-                std::cout << "Menu item " << i << ":\tx: " << menuItems[i]->getPosition().x << "\ty: " << menuItems[i]->getPosition().y << std::endl;
-            }
+        // Previews finished while they were being shown are picked up by a second pass once the worker is idle
+        bool isWaitingForThumbnail = showThumbnails();
+        if (isWaitingForThumbnail && thumbnails.isIdle())
+            isWaitingForThumbnail = showThumbnails() && !thumbnails.isIdle();
 
-        sf::Event evnt;
-        // Polling for events (for menu item clicks and other resize and close events)
-        while (window.pollEvent(evnt))
+        // Show progress of the level being loaded, start the game once it is ready
+        if (pendingLevel.valid())
         {
-            if (evnt.type == sf::Event::Closed)
+            loadingText->setString("Loading " + pendingLevelName + " " + std::to_string(static_cast<int>(loadProgress->getFraction() * 100.0f)) + "%");
+            loadingText->setOrigin(loadingText->getLocalBounds().width / 2.0f, loadingText->getLocalBounds().height);
+            isMenuDirty = true;
+            if (pendingLevel.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
             {
-                level.clearObstacles();
-                gameDrawables.clear();
-                menuDrawables.clear();
-                window.close();
-                exit(0);
-            }
-            else if (evnt.type == sf::Event::Resized)
-            {
-                // Reposition static texts
-                resizeView(evnt);
-                menuTitle->setPosition(window.getSize().x / 2.0f, window.getSize().y / 4.0f);
-                deleteLevelOption->setPosition(30.0f, window.getSize().y - 30.0f);
-                editorModeOption->setPosition(window.getSize().x - 30.0f, window.getSize().y - 30.0f);
-
-                // Reposition each element in the grid
-                for (size_t i = 0; i < menuItems.size(); i++)
+                try
+                {
+                    // Obstacles (shapes and animations) are created on this thread
+                    level = Level(pendingLevel.get());
+                }
+                catch (const std::exception &e)
                 {
-                    menuItems[i]->setPosition((window.getSize().x - 3 * 200) / 2.0f + 100 + (i % 3 * 200), window.getSize().y / 2.0f + (i / 3) * 50);
+                    // Stay in the menu if the level couldn't be loaded
+                    std::cerr << e.what() << '\n';
+                    loadingText->setString("Couldn't load " + pendingLevelName);
+                    loadingText->setOrigin(loadingText->getLocalBounds().width / 2.0f, loadingText->getLocalBounds().height);
+                    continue;
                 }
+                startGame();
             }
-            else if (evnt.type != sf::Event::MouseButtonPressed)
-                break;
-
-            handleMenuEvent();
-            render();
+        }
 
-            // If mouse click event happened check for each level menu item if they have been clicked
-            sf::Vector2i mousePos = sf::Mouse::getPosition(window);
+        if (debug == 6 && isMenuDirty)
             for (size_t i = 0; i < menuItems.size(); i++)
             {
-                if (menuItems[i].get()->getGlobalBounds().contains(mousePos.x, mousePos.y))
-                {
-                    // If level menu item clicked and in delete mode, delete them
-                    if (isDeleteMode)
-                    {
-                        // Delete the clicked level
-                        // If default menu item was clicked do nothing
-                        if (menuItems[i]->getString() != "Empty Slot")
-                        {
-                            // Setting the name to default
-                            LevelManager::getInstance()->deleteLevel(menuItems[i]->getString());
-                            menuItems[i]->setString("Empty Slot");
+                std::cout << "Menu item " << i << ":\tx: " << menuItems[i]->getPosition().x << "\ty: " << menuItems[i]->getPosition().y << std::endl;
+            }
+        renderMenu();
 
-                            // Reposition the menu item
-                            menuItems[i]->setOrigin(menuItems[i]->getGlobalBounds().width / 2.0f, menuItems[i]->getGlobalBounds().height / 2.0f);
-                            menuItems[i]->setPosition((window.getSize().x - 3 * 200) / 2.0f + 100 + (i % 3 * 200), window.getSize().y / 2.0f + (i / 3) * 50);
-                        }
-                    }
-                    // If not in delete mode load the clicked level
-                    else
-                    {
-                        // If clicked level is default level load empty level
-                        if (menuItems[i].get()->getString() == "Empty Slot")
-                            level = Level();
-                        else
-                            level = LevelManager::getInstance()->loadLevel(levels[i]);
+        // Sleep until the next event, unless a preview or a level is still being made in the background
+        sf::Event evnt;
+        const bool isBusy = pendingLevel.valid() || isWaitingForThumbnail;
+        if (!waitMenuEvent(evnt, isBusy))
+            continue;
 
-                        startGame();
-                    }
-                }
-            }
-            // Check is delete menu option was clicked
-            if (deleteLevelOption->getGlobalBounds().contains(mousePos.x, mousePos.y))
-            {
-                // Flip delete mode
-                isDeleteMode = !isDeleteMode;
+        if (evnt.type == sf::Event::Resized)
+        {
+            // Reposition static texts
+            resizeView(evnt);
+            menuTitle->setPosition(window.getSize().x / 2.0f, window.getSize().y / 4.0f);
+            deleteLevelOption->setPosition(30.0f, window.getSize().y - 30.0f);
+            editorModeOption->setPosition(window.getSize().x - 30.0f, window.getSize().y - 30.0f);
+            loadingText->setPosition(window.getSize().x / 2.0f, window.getSize().y - 30.0f);
+
+            // Reposition each element in the grid and the page navigation
+            showPage();
+            isMenuDirty = true;
+            continue;
+        }
+        // Only clicks change the menu, escape doesn't pause it
+        if (evnt.type != sf::Event::MouseButtonPressed)
+        {
+            if (evnt.type == sf::Event::Closed || evnt.type == sf::Event::GainedFocus)
+                handleMenuEvent(evnt);
+            continue;
+        }
+        isMenuDirty = true;
 
+        // Clicks are ignored until the level being loaded is ready
+        if (pendingLevel.valid())
+            continue;
+
+        // If mouse click event happened check for each level menu item if they have been clicked
+        const sf::Vector2i mousePos(evnt.mouseButton.x, evnt.mouseButton.y);
+        for (size_t i = 0; i < menuItems.size(); i++)
+        {
+            if (menuItems[i].get()->getGlobalBounds().contains(mousePos.x, mousePos.y))
+            {
+                // If level menu item clicked and in delete mode, delete them
                 if (isDeleteMode)
                 {
-                    // Set all menu items name to red
-                    for (std::shared_ptr<sf::Text> &menuItem : menuItems)
-                        menuItem->setFillColor(sf::Color::Red);
+                    // Delete the clicked level
+                    // If default menu item was clicked do nothing
+                    if (menuItems[i]->getString() != "Empty Slot")
+                    {
+                        // Later levels move forward to fill the slot
+                        thumbnails.forget(menuItems[i]->getString());
+                        LevelManager::getInstance()->deleteLevel(menuItems[i]->getString());
+                        showPage();
+                    }
                 }
+                // If not in delete mode load the clicked level
                 else
                 {
-                    // Set all menu items name to default
-                    for (std::shared_ptr<sf::Text> &menuItem : menuItems)
-                        menuItem->setFillColor(sf::Color::White);
+                    // If clicked level is default level load empty level
+                    if (menuItems[i].get()->getString() == "Empty Slot")
+                    {
+                        level = Level();
+                        startGame();
+                    }
+                    // Otherwise load it in the background, the game is started by the menu loop
+                    else
+                    {
+                        pendingLevelName = menuItems[i]->getString();
+                        loadProgress = std::make_shared<LevelLoadProgress>();
+                        pendingLevel = LevelManager::getInstance()->loadLevelDataAsync(pendingLevelName, loadProgress);
+                    }
                 }
             }
+        }
+        // Check if one of the page navigation options was clicked
+        if (previousPageOption->getGlobalBounds().contains(mousePos.x, mousePos.y) && page > 0)
+        {
+            page--;
+            showPage();
+        }
+        if (nextPageOption->getGlobalBounds().contains(mousePos.x, mousePos.y))
+        {
+            page++;
+            showPage();
+        }
 
-            // Check is editor mode menu item was clicked
-            if (editorModeOption->getGlobalBounds().contains(mousePos.x, mousePos.y))
+        // Check is delete menu option was clicked
+        if (deleteLevelOption->getGlobalBounds().contains(mousePos.x, mousePos.y))
+        {
+            // Flip delete mode
+            isDeleteMode = !isDeleteMode;
+
+            if (isDeleteMode)
             {
-                // Flip editor mode status
-                isEditorMode = !isEditorMode;
+                // Set all menu items name to red
+                for (std::shared_ptr<sf::Text> &menuItem : menuItems)
+                    menuItem->setFillColor(sf::Color::Red);
+            }
+            else
+            {
+                // Set all menu items name to default
+                for (std::shared_ptr<sf::Text> &menuItem : menuItems)
+                    menuItem->setFillColor(sf::Color::White);
+            }
+        }
 
-                if (isEditorMode)
-                {
-                    // Set all menu items name to magenta
-                    for (std::shared_ptr<sf::Text> &menuItem : menuItems)
-                        menuItem->setFillColor(sf::Color::Magenta);
-                }
-                else
-                {
-                    // Set all menu items name to default
-                    for (std::shared_ptr<sf::Text> &menuItem : menuItems)
-                        menuItem->setFillColor(sf::Color::White);
-                }
+        // Check is editor mode menu item was clicked
+        if (editorModeOption->getGlobalBounds().contains(mousePos.x, mousePos.y))
+        {
+            // Flip editor mode status
+            isEditorMode = !isEditorMode;
+
+            if (isEditorMode)
+            {
+                // Set all menu items name to magenta
+                for (std::shared_ptr<sf::Text> &menuItem : menuItems)
+                    menuItem->setFillColor(sf::Color::Magenta);
+            }
+            else
+            {
+                // Set all menu items name to default
+                for (std::shared_ptr<sf::Text> &menuItem : menuItems)
+                    menuItem->setFillColor(sf::Color::White);
             }
         }
     }
@@ -759,46 +1011,60 @@ void startMainMenu()
  */
 void displayPauseOverlay()
 {
-    menuDrawables.clear();
+    // The items are created once and kept for every later pause
+    static const std::shared_ptr<sf::RectangleShape> overlay(std::make_shared<sf::RectangleShape>());
+    static const std::shared_ptr<sf::Text> pausedText(std::make_shared<sf::Text>("Paused", font, menuTitleSize));
+    static const std::shared_ptr<sf::Text> backToMenuText(std::make_shared<sf::Text>("Back to main menu", font, 20));
+    static const std::shared_ptr<sf::Text> saveText(std::make_shared<sf::Text>("Save level", font, 20));
 
-    // Create semi-transparent black background rectangle as basis for overlay at the bottom
-    std::shared_ptr<sf::RectangleShape> overlay(std::make_shared<sf::RectangleShape>(sf::Vector2f(window.getSize().x, window.getSize().y)));
+    // Semi-transparent black background rectangle as basis for overlay at the bottom
     overlay->setFillColor(sf::Color(0, 0, 0, 191));
-    menuDrawables.push_back(overlay);
-
-    // Create "Paused" text at the top
-    std::shared_ptr<sf::Text> pausedText(std::make_shared<sf::Text>("Paused", font, menuTitleSize));
+    // "Paused" text at the top, then back to main menu item
     pausedText->setFillColor(sf::Color::White);
     pausedText->setOrigin(pausedText->getLocalBounds().width / 2.0f, pausedText->getLocalBounds().height / 2.0f);
-    pausedText->setPosition(window.getSize().x / 2.0f, window.getSize().y / 4.0f);
-    menuDrawables.push_back(pausedText);
-
-    // Create back to main menu item
-    std::shared_ptr<sf::Text> backToMenuText(std::make_shared<sf::Text>("Back to main menu", font, 20));
     backToMenuText->setFillColor(sf::Color::White);
     backToMenuText->setOrigin(backToMenuText->getLocalBounds().width / 2.0f, backToMenuText->getLocalBounds().height / 2.0f);
-    backToMenuText->setPosition(window.getSize().x / 2.0f, window.getSize().y / 2.0f);
-    menuDrawables.push_back(backToMenuText);
-
-    // Create save level option, set it to fully white if editor mode is enabled (because saving only makes sense in that case)
-    std::shared_ptr<sf::Text> saveText(std::make_shared<sf::Text>("Save level", font, 20));
-    saveText->setFillColor(sf::Color(255, 255, 255, 100));
-    if (isEditorMode)
-        saveText->setFillColor(sf::Color::White);
+    // Save level option, set it to fully white if editor mode is enabled (because saving only makes sense in that case)
+    saveText->setFillColor(isEditorMode ? sf::Color::White : sf::Color(255, 255, 255, 100));
     saveText->setOrigin(saveText->getLocalBounds().width / 2.0f, saveText->getLocalBounds().height / 2.0f);
-    saveText->setPosition(window.getSize().x / 2.0f, window.getSize().y / 2.0f + 50.0f);
+
+    // Place the items according to the size of the window
+    auto layout = []()
+    {
+        overlay->setSize(sf::Vector2f(window.getSize().x, window.getSize().y));
+        pausedText->setPosition(window.getSize().x / 2.0f, window.getSize().y / 4.0f);
+        backToMenuText->setPosition(window.getSize().x / 2.0f, window.getSize().y / 2.0f);
+        saveText->setPosition(window.getSize().x / 2.0f, window.getSize().y / 2.0f + 50.0f);
+    };
+    layout();
+
+    menuDrawables.clear();
+    menuDrawables.push_back(overlay);
+    menuDrawables.push_back(pausedText);
+    menuDrawables.push_back(backToMenuText);
     menuDrawables.push_back(saveText);
 
-    // Pause menu loop
+    // Pause menu loop, sleeps until the next event and only draws a frame if something changed
+    isMenuDirty = true;
     while (window.isOpen() && isPause)
     {
-        render();
-        handleMenuEvent();
+        renderMenu();
+
+        sf::Event evnt;
+        if (!waitMenuEvent(evnt, false))
+            continue;
+        if (evnt.type == sf::Event::Resized)
+        {
+            resizeView(evnt);
+            layout();
+            isMenuDirty = true;
+        }
+        handleMenuEvent(evnt);
 
         // If clicked
-        if (sf::Mouse::isButtonPressed(sf::Mouse::Left))
+        if (evnt.type == sf::Event::MouseButtonPressed && evnt.mouseButton.button == sf::Mouse::Left)
         {
-            sf::Vector2i mousePos = sf::Mouse::getPosition(window);
+            const sf::Vector2i mousePos(evnt.mouseButton.x, evnt.mouseButton.y);
 
             // If back to main menu item has been clicked wipe everything and return to the main menu
             if (backToMenuText->getGlobalBounds().contains(mousePos.x, mousePos.y))
@@ -843,6 +1109,12 @@ void saveMenu()
     inputText->setPosition(window.getSize().x / 2.0f, window.getSize().y / 2.0f);
     menuDrawables.push_back(inputText);
 
+    // Create error text, empty until saving fails
+    std::shared_ptr<sf::Text> errorText(std::make_shared<sf::Text>("", font, 20));
+    errorText->setFillColor(sf::Color::Red);
+    errorText->setPosition(window.getSize().x / 2.0f, window.getSize().y / 2.0f + 50.0f);
+    menuDrawables.push_back(errorText);
+
     // Create back text
     std::shared_ptr<sf::Text> backText(std::make_shared<sf::Text>("Back", font, 20));
     backText->setFillColor(sf::Color::White);
@@ -853,14 +1125,15 @@ void saveMenu()
     // Boolean for checking if input is still to be expected
     bool isEnteringName = true;
 
-    // Input loop
+    // Input loop, sleeps until the next event and only draws a frame if something changed
+    isMenuDirty = true;
     while (window.isOpen() && isEnteringName)
     {
-        render();
+        renderMenu();
 
         sf::Event evnt;
-        // Poll for events
-        while (window.pollEvent(evnt))
+        // Wait for events
+        if (waitMenuEvent(evnt, false))
         {
             sf::Vector2i mousePos = sf::Mouse::getPosition(window);
             switch (evnt.type)
@@ -875,7 +1148,12 @@ void saveMenu()
             case sf::Event::Resized:
                 resizeView(evnt);
                 inputText->setPosition(window.getSize().x / 2.0f, window.getSize().y / 2.0f);
+                errorText->setPosition(window.getSize().x / 2.0f, window.getSize().y / 2.0f + 50.0f);
                 backText->setPosition(window.getSize().x / 2.0f, window.getSize().y / 2.0f + 100.0f);
+                isMenuDirty = true;
+                break;
+            case sf::Event::GainedFocus:
+                isMenuDirty = true;
                 break;
             case sf::Event::MouseButtonPressed:
                 // If back button is clicked, return to pause menu
@@ -893,9 +1171,19 @@ void saveMenu()
                     if (level.setName(levelName))
                     {
                         // We can proceed with saving the level
-                        isEnteringName = false;
                         level.setPlayerStartPos(player.getBody()->getPosition());
-                        LevelManager::getInstance()->saveLevel(level);
+                        try
+                        {
+                            LevelManager::getInstance()->saveLevel(level);
+                            isEnteringName = false;
+                        }
+                        catch (const std::exception &e)
+                        {
+                            // Stay in the menu, the old files of the level are kept if it couldn't be saved
+                            std::cerr << e.what() << '\n';
+                            errorText->setString("Couldn't save " + levelName);
+                            errorText->setOrigin(errorText->getLocalBounds().width / 2.0f, errorText->getLocalBounds().height / 2.0f);
+                        }
                     }
                 }
                 // If backspace is pressed, delete the last character
@@ -914,6 +1202,7 @@ void saveMenu()
                 }
 
                 // If text was entered, recenter whole textbox to the middle of the screen
+                isMenuDirty = true;
                 inputText->setOrigin(inputText->getLocalBounds().width / 2.0f, inputText->getLocalBounds().height / 2.0f);
                 inputText->setPosition(window.getSize().x / 2.0f, window.getSize().y / 2.0f);
 
@@ -0,0 +1,87 @@
+#include <string>
+#include <stdexcept>
+
+#include "mappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+// Map with a file mapping object, the handles are kept until the view is unmapped
+// FILE_SHARE_DELETE only lets the file be renamed while it is open, Windows refuses to delete or replace a file with a mapped view,
+// so the level manager releases the mappings of a level before it writes the level
+MappedFile::MappedFile(const std::string &path)
+    : data(nullptr), size(0), fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr)
+{
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("MappedFile: Couldn't open " + path);
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(fileHandle);
+        throw std::runtime_error("MappedFile: Empty or unreadable file " + path);
+    }
+    size = static_cast<size_t>(fileSize.QuadPart);
+
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle != nullptr)
+        data = static_cast<const unsigned char *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (data == nullptr)
+    {
+        if (mappingHandle != nullptr)
+            CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+        throw std::runtime_error("MappedFile: Couldn't map " + path);
+    }
+}
+
+// Unmap view and close handles
+MappedFile::~MappedFile()
+{
+    UnmapViewOfFile(data);
+    CloseHandle(mappingHandle);
+    CloseHandle(fileHandle);
+}
+
+#else
+
+// Map with mmap, the descriptor can be closed right away
+MappedFile::MappedFile(const std::string &path)
+    : data(nullptr), size(0)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("MappedFile: Couldn't open " + path);
+
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size == 0)
+    {
+        close(fd);
+        throw std::runtime_error("MappedFile: Empty or unreadable file " + path);
+    }
+    size = static_cast<size_t>(status.st_size);
+
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        throw std::runtime_error("MappedFile: Couldn't map " + path);
+    data = static_cast<const unsigned char *>(mapping);
+}
+
+// Unmap the contents
+MappedFile::~MappedFile()
+{
+    munmap(const_cast<unsigned char *>(data), size);
+}
+
+#endif
@@ -12,21 +12,25 @@ extern Player player;
 extern sf::RenderWindow window;
 
 ObstacleAnimation::ObstacleAnimation(const Animation::Type type) : Animation(type)
-{  
-    texture = type == Animation::Type::RepulseObstacle ? repulseTexture : attractTexture;
+{
 }
 
+// Shade and scale the body by its distance to the player, obstacles of a level are drawn by ObstacleRenderer instead
 void ObstacleAnimation::applyTransform(Charge &toTransform) const
 {
     if (typeid(toTransform) != typeid(Obstacle))
         throw std::invalid_argument("toTransform must be of type Obstacle");
 
-    Obstacle &obstacle = dynamic_cast<Obstacle &>(toTransform);
-
-    static const float distanceFactor = std::sqrt(window.getSize().x * window.getSize().x + window.getSize().y * window.getSize().y)
-                                         * window.getSize().x + window.getSize().y * window.getSize().y / 2.0f;
-    float colorCorrection = std::max(0.65f, 1.0f - obstacle.getDistanceSquaredToPlayer() / distanceFactor);
+    const sf::Vector2f vectorToPlayer = toTransform.getBody()->getPosition() - player.getBody()->getPosition();
+    float colorCorrection = getColorCorrection(vectorToPlayer.x * vectorToPlayer.x + vectorToPlayer.y * vectorToPlayer.y);
 
     toTransform.getBody()->setFillColor(sf::Color(255 * colorCorrection, 255 * colorCorrection, 255 * colorCorrection, 255 * colorCorrection));
     toTransform.getBody()->setScale(colorCorrection, colorCorrection);
+}
+
+float ObstacleAnimation::getColorCorrection(const float distanceSquared)
+{
+    static const float distanceFactor = std::sqrt(window.getSize().x * window.getSize().x + window.getSize().y * window.getSize().y)
+                                         * window.getSize().x + window.getSize().y * window.getSize().y / 2.0f;
+    return std::max(0.65f, 1.0f - distanceSquared / distanceFactor);
 }
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include <SFML\Graphics.hpp>
+#include <cstddef>
+#include <iostream>
+
+#include "obstacleRenderer.h"
+#include "obstacleAnimation.h"
+#include "animation.h"
+#include "chargeStore.h"
+
+extern const char debug;
+
+// Constructor, every quad is made of two triangles
+ObstacleRenderer::ObstacleRenderer()
+    : vertices(sf::Triangles)
+{
+}
+
+// The quad of a charge covers its body and maps the area of its texture in the atlas
+void ObstacleRenderer::update(const ChargeStore &charges, const sf::Vector2f &playerPos)
+{
+    const float *x = charges.getX();
+    const float *y = charges.getY();
+    const float *q = charges.getCharge();
+    const float *r = charges.getCollisionRadius();
+    vertices.resize(charges.size() * 6);
+
+    const sf::FloatRect attractRect(Animation::getTypeTextureRect(Animation::Type::AttractObstacle));
+    const sf::FloatRect repulseRect(Animation::getTypeTextureRect(Animation::Type::RepulseObstacle));
+
+    for (size_t i = 0; i < charges.size(); i++)
+    {
+        const float dx = x[i] - playerPos.x;
+        const float dy = y[i] - playerPos.y;
+        const float colorCorrection = ObstacleAnimation::getColorCorrection(dx * dx + dy * dy);
+        if (debug == 7)
+            std::cout << "Obstacle:\tx: " << dx << "\ty: " << dy << "\tDistance to player: " << dx * dx + dy * dy << std::endl;
+        const sf::Uint8 shade = static_cast<sf::Uint8>(255 * colorCorrection);
+        const sf::Color color(shade, shade, shade, shade);
+
+        // The body of an obstacle is 4 times its collision radius
+        const float halfSize = r[i] * 4.0f * colorCorrection;
+        const float left = x[i] - halfSize;
+        const float right = x[i] + halfSize;
+        const float top = y[i] - halfSize;
+        const float bottom = y[i] + halfSize;
+
+        const sf::FloatRect &textureRect = q[i] < 0.0f ? repulseRect : attractRect;
+        const float textureRight = textureRect.left + textureRect.width;
+        const float textureBottom = textureRect.top + textureRect.height;
+
+        sf::Vertex *quad = &vertices[i * 6];
+        quad[0] = sf::Vertex(sf::Vector2f(left, top), color, sf::Vector2f(textureRect.left, textureRect.top));
+        quad[1] = sf::Vertex(sf::Vector2f(right, top), color, sf::Vector2f(textureRight, textureRect.top));
+        quad[2] = sf::Vertex(sf::Vector2f(right, bottom), color, sf::Vector2f(textureRight, textureBottom));
+        quad[3] = quad[0];
+        quad[4] = quad[2];
+        quad[5] = sf::Vertex(sf::Vector2f(left, bottom), color, sf::Vector2f(textureRect.left, textureBottom));
+    }
+}
+
+// A single draw call with the atlas
+void ObstacleRenderer::draw(sf::RenderTarget &target, sf::RenderStates states) const
+{
+    if (vertices.getVertexCount() == 0)
+        return;
+    states.texture = Animation::getAtlas();
+    target.draw(vertices, states);
+}
@@ -1,29 +1,164 @@
-#include <SFML\Graphics.hpp>
+#include <SFML\System.hpp>
 #include <cmath>
 #include <iostream>
+#include <thread>
+#include <algorithm>
 
-#include "obstacle.h"
 #include "physics.h"
 #include "settings.h"
-#include "level.h"
+#include "chargeStore.h"
+#include "forceKernel.h"
+#include "fieldGrid.h"
+#include "playerState.h"
+#include "simulationContext.h"
 
 extern const char debug;
+extern const float playerMaxSpeed;
 
-extern sf::RenderWindow window;
-extern Player player;
-extern Level level;
-extern bool isPause;
+const ChargeStore PhysicsEngine::noCharges;
 
+// Limit both components of the speed to playerMaxSpeed
+static sf::Vector2f clampSpeed(const sf::Vector2f &speed)
+{
+    return sf::Vector2f(std::max(-playerMaxSpeed, std::min(playerMaxSpeed, speed.x)), std::max(-playerMaxSpeed, std::min(playerMaxSpeed, speed.y)));
+}
 
 // Construct based on provided constants.
 // Not singleton to allow constants to change (it might be interesting gameplay as a later addition)
 PhysicsEngine::PhysicsEngine(const float coulombConst, const float frictionCoeff, const float g)
-    : k(coulombConst), frictionCoeff(frictionCoeff), g(g)
+    : k(coulombConst), frictionCoeff(frictionCoeff), g(g), forceKernel(detectForceKernel()),
+      charges(&noCharges), bounds(windowWidth, windowHeight),
+      solver(physicsSolver == 2 ? Solver::FieldGrid : physicsSolver == 1 ? Solver::BarnesHut : Solver::Direct), openingAngle(barnesHutOpeningAngle),
+      fieldGridCellSize(fieldGridResolution), fieldGridInterpolation(fieldGridInterpolationOrder == 3 ? FieldGrid::Interpolation::Bicubic : FieldGrid::Interpolation::Bilinear),
+      collisionHash(collisionHashCellSize), preparedRevision(0),
+      integrator(static_cast<Integrator>(physicsIntegrator)), adaptiveTolerance(integratorTolerance)
+{
+    if (debug == 1)
+        std::cout << "Force kernel:\t" << getForceKernelName(forceKernel) << std::endl;
+}
+
+// Bind obstacles and walls, data structures are updated on the next step
+void PhysicsEngine::setCharges(const ChargeStore &newCharges, const sf::Vector2u &newBounds)
+{
+    if (charges != &newCharges)
+        preparedRevision = 0;
+    charges = &newCharges;
+    bounds = newBounds;
+}
+
+// Switch solver, data structures are built on the next update
+void PhysicsEngine::setSolver(const Solver newSolver)
+{
+    solver = newSolver;
+    preparedRevision = 0;
+}
+
+// Switch integrator, cached data of the previous one is dropped
+void PhysicsEngine::setIntegrator(const Integrator newIntegrator)
+{
+    integrator = newIntegrator;
+    playerContext.invalidateCache();
+}
+
+// Change field grid settings, grid is baked on the next update
+void PhysicsEngine::setFieldGrid(const float cellSize, const FieldGrid::Interpolation interpolation)
+{
+    fieldGridCellSize = cellSize;
+    fieldGridInterpolation = interpolation;
+    preparedRevision = 0;
+}
+
+// Build data structures of the selected solver
+void PhysicsEngine::prepare()
+{
+    if (solver == Solver::BarnesHut)
+        quadtree.build(*charges, bounds);
+    else
+        quadtree.clear();
+
+    // Field grid is baked on every core
+    if (solver == Solver::FieldGrid)
+        fieldGrid.bake(*charges, bounds, fieldGridCellSize, forceKernel, std::max(1u, std::thread::hardware_concurrency()));
+    else
+        fieldGrid.clear();
+
+    // Collisions are checked with every solver
+    collisionHash.clear();
+    for (size_t i = 0; i < charges->size(); i++)
+        collisionHash.insert(i, sf::Vector2f(charges->getX()[i], charges->getY()[i]), charges->getCollisionRadius()[i]);
+
+    preparedRevision = charges->getRevision();
+    preparedSize = bounds;
+
+    if (debug == 8)
+        std::cout << "Prepared solver for " << charges->size() << " obstacles, quadtree nodes: " << quadtree.getNodeCount()
+                  << ", field grid nodes: " << fieldGrid.getNodeCount() << std::endl;
+}
+
+// Apply edits since the last update, rebuild if they are not available
+void PhysicsEngine::synchronize()
+{
+    if (charges->getRevision() == preparedRevision && bounds == preparedSize)
+        return;
+
+    std::vector<ChargeDelta> deltas;
+    if (preparedRevision == 0 || bounds != preparedSize || !charges->getDeltasSince(preparedRevision, deltas))
+    {
+        prepare();
+        return;
+    }
+
+    for (const ChargeDelta &delta : deltas)
+    {
+        if (!applyChargeDelta(delta))
+        {
+            prepare();
+            return;
+        }
+    }
+    preparedRevision = charges->getRevision();
+
+    if (debug == 8)
+        std::cout << "Applied " << deltas.size() << " obstacle edits" << std::endl;
+}
+
+// Apply a single edit to the solver data structures
+bool PhysicsEngine::applyChargeDelta(const ChargeDelta &delta)
 {
+    const bool isAdded = delta.type == ChargeDelta::Type::Add;
+
+    // Collisions only need to know whether a circle is there, so removed circles are found by their center and radius
+    if (isAdded)
+        collisionHash.insert(delta.index, sf::Vector2f(delta.x, delta.y), delta.collisionRadius);
+    else if (!collisionHash.removeCircle(sf::Vector2f(delta.x, delta.y), delta.collisionRadius))
+        return false;
+
+    // Removing a charge is adding its opposite to the field
+    if (solver == Solver::FieldGrid)
+        fieldGrid.addCharge(delta.x, delta.y, isAdded ? delta.q : -delta.q);
+
+    // Quadtree moments are updated on the path to the leaf of the charge
+    if (solver == Solver::BarnesHut)
+        return isAdded ? quadtree.insert(delta.x, delta.y, delta.q) : quadtree.remove(delta.x, delta.y, delta.q);
+
+    return true;
+}
+
+// Compare Barnes-Hut approximation to the exact sum at the given position
+float PhysicsEngine::measureBarnesHutError(const sf::Vector2f &pos) const
+{
+    const sf::Vector2f exact = sumElectricField(charges->getX(), charges->getY(), charges->getCharge(), charges->size(), pos, forceKernel);
+    const sf::Vector2f approximated = quadtree.evaluate(pos, openingAngle, forceKernel);
+
+    const sf::Vector2f difference = approximated - exact;
+    const float exactLength = std::sqrt(exact.x * exact.x + exact.y * exact.y);
+    if (exactLength == 0.0f)
+        return 0.0f;
+    return std::sqrt(difference.x * difference.x + difference.y * difference.y) / exactLength;
 }
 
 // Calculate electric force
-const sf::Vector2f PhysicsEngine::calculateElectricForce() const
+const sf::Vector2f PhysicsEngine::calculateElectricForce(const sf::Vector2f &pos, const double electricCharge) const
 {
 
     // Calculate force vector for each obstacle with the player and sum them
@@ -31,81 +166,398 @@ const sf::Vector2f PhysicsEngine::calculateElectricForce() const
     // Where ri is a vector pointing from the obstacle to the player
     sf::Vector2f totalForce(0.0, 0.0);
 
-    // Calculate force vector for each obstacle with the player and sum them
-    // Formula: F(r) = k * q_player sum(q_obstacle * (ri / abs(ri)^3))
-    for (const std::shared_ptr<Obstacle> &obstacle : level.getObstacles())
+    // Sum the field of every obstacle at the position of the player
+    if (solver == Solver::FieldGrid)
+    {
+        // Field is interpolated from the precomputed grid
+        totalForce = fieldGrid.sample(pos, fieldGridInterpolation);
+    }
+    else if (solver == Solver::BarnesHut)
     {
-        // It is divided by the cube of riLength
-        // x component
-        totalForce.x += obstacle.get()->getElectricCharge() * (obstacle->getVectorToPlayer().x / (obstacle->getDistanceSquaredToPlayer() * std::sqrt(obstacle->getDistanceSquaredToPlayer())));
-        // y component
-        totalForce.y += obstacle.get()->getElectricCharge() * (obstacle->getVectorToPlayer().y / (obstacle->getDistanceSquaredToPlayer() * std::sqrt(obstacle->getDistanceSquaredToPlayer())));
+        // Far away groups of obstacles are approximated by the quadtree
+        totalForce = quadtree.evaluate(pos, openingAngle, forceKernel);
+        if (debug == 8)
+            std::cout << "Barnes-Hut relative error:\t" << measureBarnesHutError(pos) << std::endl;
     }
+    else
+    {
+        // Obstacle data is streamed from the contiguous arrays of the charge store by the vectorized kernel
+        totalForce = sumElectricField(charges->getX(), charges->getY(), charges->getCharge(), charges->size(), pos, forceKernel);
+    }
+
     // Multiply the sum to get total force
-    totalForce.x *= k * player.getElectricCharge();
-    totalForce.y *= k * player.getElectricCharge();
+    totalForce.x *= k * electricCharge;
+    totalForce.y *= k * electricCharge;
 
     return totalForce;
 }
 
 // Calculate friction force
-const sf::Vector2f PhysicsEngine::calculateFrictionForce() const
+const sf::Vector2f PhysicsEngine::calculateFrictionForce(const sf::Vector2f &speed, const double mass) const
 {
     // Friction is linearly proportional to the speed of the player (similar to drag irl)
-    return sf::Vector2f((frictionCoeff * player.getSpeed().x / playerMaxSpeed) * player.getMass() * g,
-                        (frictionCoeff * player.getSpeed().y / playerMaxSpeed) * player.getMass() * g);
+    return sf::Vector2f((frictionCoeff * speed.x / playerMaxSpeed) * mass * g,
+                        (frictionCoeff * speed.y / playerMaxSpeed) * mass * g);
 }
 
-// Checks for collisions between Player and walls and obstacles.
-void PhysicsEngine::checkCollision()
+// Calculate acceleration from the forces acting on the player
+sf::Vector2f PhysicsEngine::calculateAcceleration(const PlayerState &state, SimulationContext &context) const
 {
-    // Get player position
-    const sf::Vector2f playerPos(player.getBody()->getPosition());
-    // Check for each obstacle
-    for (const std::shared_ptr<Obstacle> &obstacle : level.getObstacles())
+    context.forceEvaluations++;
+
+    // Electric force minus a friction force proportionally linked to the speed
+    const sf::Vector2f totalForce = calculateElectricForce(state.position, context.traits.electricCharge) - calculateFrictionForce(state.speed, context.traits.mass);
+
+    if (debug == 2)
+        std::cout << "total force:\t" << std::sqrt(totalForce.x * totalForce.x + totalForce.y * totalForce.y)
+                  << "\t\tx: " << totalForce.x << "\ty: " << totalForce.y << std::endl;
+
+    // To get acceleration divide force by mass
+    return sf::Vector2f(totalForce.x / context.traits.mass, totalForce.y / context.traits.mass);
+}
+
+// Calculate acceleration of several players, the direct solver loads every obstacle once for all of them
+void PhysicsEngine::calculateAccelerations(const PlayerState *states, SimulationContext *const *simulations, const size_t count, sf::Vector2f *accelerations) const
+{
+    if (solver != Solver::Direct)
     {
-        // Check if the distance between player and obstacle is less than the sum of their radii
-        if (obstacle->getDistanceSquaredToPlayer() < (player.getCollisionRadius() + obstacle->getCollisionRadius()) * (player.getCollisionRadius() + obstacle->getCollisionRadius()))
-            isPause = true;
+        for (size_t lane = 0; lane < count; lane++)
+            accelerations[lane] = calculateAcceleration(states[lane], *simulations[lane]);
+        return;
     }
 
-    // Check collision with walls of the window, simulate perfectly elastic collision, where walls have infinite weight 
-    // So just set the corresponding component of player's speed to its opposite
-    sf::Vector2f windowSize(window.getSize());
-    sf::Vector2f playerSpeed(player.getSpeed());
-    if (playerPos.x < 0 || playerPos.x > windowSize.x)
-        playerSpeed.x = -playerSpeed.x;
-    if (playerPos.y < 0 || playerPos.y > windowSize.y)
-        playerSpeed.y = -playerSpeed.y;
+    // Positions are gathered into contiguous arrays for the lane kernel
+    float posX[simulationLaneCount] = {}, posY[simulationLaneCount] = {};
+    float fieldX[simulationLaneCount], fieldY[simulationLaneCount];
+    for (size_t lane = 0; lane < count; lane++)
+    {
+        posX[lane] = states[lane].position.x;
+        posY[lane] = states[lane].position.y;
+    }
+    sumElectricFieldLanes(charges->getX(), charges->getY(), charges->getCharge(), charges->size(), posX, posY, count, fieldX, fieldY, forceKernel);
 
-    // And finally set the speed
-    player.setSpeed(playerSpeed);
+    // Same formula as calculateAcceleration()
+    for (size_t lane = 0; lane < count; lane++)
+    {
+        SimulationContext &simulation = *simulations[lane];
+        simulation.forceEvaluations++;
+
+        sf::Vector2f electricForce(fieldX[lane], fieldY[lane]);
+        electricForce.x *= k * simulation.traits.electricCharge;
+        electricForce.y *= k * simulation.traits.electricCharge;
+        const sf::Vector2f totalForce = electricForce - calculateFrictionForce(states[lane].speed, simulation.traits.mass);
+        accelerations[lane] = sf::Vector2f(totalForce.x / simulation.traits.mass, totalForce.y / simulation.traits.mass);
+    }
 }
 
-// Update player movement
-void PhysicsEngine::updatePlayer()
+// Advance states of several players with the selected integrator, every stage evaluates the forces together
+void PhysicsEngine::integrateLanes(SimulationContext *const *simulations, const size_t count, const float timeStep, PlayerState *next) const
 {
-    // Initialize total force
-    sf::Vector2f totalForce(0.0, 0.0);
+    PlayerState states[simulationLaneCount];
+    PlayerState stageStates[simulationLaneCount];
+    sf::Vector2f accelerations[simulationLaneCount];
+    for (size_t lane = 0; lane < count; lane++)
+        states[lane] = simulations[lane]->state;
 
-    // Add the electric part
-    totalForce += calculateElectricForce();
+    switch (integrator)
+    {
+    case Integrator::ExplicitEuler:
+    {
+        calculateAccelerations(states, simulations, count, accelerations);
+        for (size_t lane = 0; lane < count; lane++)
+        {
+            next[lane].position = states[lane].position + states[lane].speed * timeStep;
+            next[lane].speed = states[lane].speed + accelerations[lane] * timeStep;
+        }
+        break;
+    }
+    case Integrator::VelocityVerlet:
+    {
+        // Players without a cached acceleration are evaluated together
+        SimulationContext *missing[simulationLaneCount];
+        size_t missingLane[simulationLaneCount];
+        size_t missingCount = 0;
+        for (size_t lane = 0; lane < count; lane++)
+        {
+            const SimulationContext &simulation = *simulations[lane];
+            if (simulation.isVerletCacheValid && simulation.verletState.position == states[lane].position && simulation.verletState.speed == states[lane].speed)
+                accelerations[lane] = simulation.verletAcceleration;
+            else
+            {
+                stageStates[missingCount] = states[lane];
+                missing[missingCount] = simulations[lane];
+                missingLane[missingCount++] = lane;
+            }
+        }
+        sf::Vector2f missingAccelerations[simulationLaneCount];
+        if (missingCount != 0)
+            calculateAccelerations(stageStates, missing, missingCount, missingAccelerations);
+        for (size_t i = 0; i < missingCount; i++)
+            accelerations[missingLane[i]] = missingAccelerations[i];
 
-    // Subtract a friction force proportionally linked to the speed
-     totalForce -= calculateFrictionForce();
+        for (size_t lane = 0; lane < count; lane++)
+        {
+            next[lane].position = states[lane].position + states[lane].speed * timeStep + accelerations[lane] * (timeStep * timeStep / 2.0f);
+            stageStates[lane] = PlayerState{next[lane].position, states[lane].speed + accelerations[lane] * timeStep};
+        }
+        sf::Vector2f nextAccelerations[simulationLaneCount];
+        calculateAccelerations(stageStates, simulations, count, nextAccelerations);
+        for (size_t lane = 0; lane < count; lane++)
+        {
+            next[lane].speed = states[lane].speed + (accelerations[lane] + nextAccelerations[lane]) * (timeStep / 2.0f);
 
-    if (debug == 2)
-        std::cout << "total force:\t" << std::sqrt(totalForce.x * totalForce.x + totalForce.y * totalForce.y)
-                  << "\t\tx: " << totalForce.x << "\ty: " << totalForce.y << std::endl;
+            SimulationContext &simulation = *simulations[lane];
+            simulation.verletState = next[lane];
+            simulation.verletAcceleration = nextAccelerations[lane];
+            simulation.isVerletCacheValid = true;
+        }
+        break;
+    }
+    case Integrator::RK4:
+    {
+        // Stage speeds are the position derivatives, accelerations the speed derivatives
+        sf::Vector2f stageSpeeds[4][simulationLaneCount];
+        sf::Vector2f stageAccelerations[4][simulationLaneCount];
+        static const float stageFactors[4] = {0.0f, 0.5f, 0.5f, 1.0f};
+        for (size_t stage = 0; stage < 4; stage++)
+        {
+            for (size_t lane = 0; lane < count; lane++)
+            {
+                if (stage == 0)
+                    stageSpeeds[0][lane] = states[lane].speed;
+                else
+                    stageSpeeds[stage][lane] = states[lane].speed + stageAccelerations[stage - 1][lane] * (timeStep * stageFactors[stage]);
+                const sf::Vector2f position = stage == 0 ? states[lane].position : states[lane].position + stageSpeeds[stage - 1][lane] * (timeStep * stageFactors[stage]);
+                stageStates[lane] = PlayerState{position, stageSpeeds[stage][lane]};
+            }
+            calculateAccelerations(stageStates, simulations, count, stageAccelerations[stage]);
+        }
+        for (size_t lane = 0; lane < count; lane++)
+        {
+            next[lane].position = states[lane].position + (stageSpeeds[0][lane] + 2.0f * stageSpeeds[1][lane] + 2.0f * stageSpeeds[2][lane] + stageSpeeds[3][lane]) * (timeStep / 6.0f);
+            next[lane].speed = states[lane].speed + (stageAccelerations[0][lane] + 2.0f * stageAccelerations[1][lane] + 2.0f * stageAccelerations[2][lane] + stageAccelerations[3][lane]) * (timeStep / 6.0f);
+        }
+        break;
+    }
+    case Integrator::SemiImplicitEuler:
+    default:
+    {
+        calculateAccelerations(states, simulations, count, accelerations);
+        for (size_t lane = 0; lane < count; lane++)
+        {
+            // The new speed is limited before it moves the player, like integrate() does
+            next[lane].speed = clampSpeed(states[lane].speed + accelerations[lane] * timeStep);
+            next[lane].position = states[lane].position + next[lane].speed * timeStep;
+        }
+        break;
+    }
+    }
+}
 
-    // To get acceleration divide force by mass
-    sf::Vector2f acceleration(0.0, 0.0);
-    acceleration.x = totalForce.x / player.getMass();
-    acceleration.y = totalForce.y / player.getMass();
+// Advance state with the selected integrator
+PlayerState PhysicsEngine::integrate(const PlayerState &state, const float timeStep, SimulationContext &context) const
+{
+    PlayerState next;
+    switch (integrator)
+    {
+    case Integrator::ExplicitEuler:
+    {
+        // Position is advanced with the old speed
+        const sf::Vector2f acceleration = calculateAcceleration(state, context);
+        next.position = state.position + state.speed * timeStep;
+        next.speed = state.speed + acceleration * timeStep;
+        break;
+    }
+    case Integrator::VelocityVerlet:
+    {
+        // The acceleration at the end of the last step is reused if nothing changed the state since
+        sf::Vector2f acceleration;
+        if (context.isVerletCacheValid && context.verletState.position == state.position && context.verletState.speed == state.speed)
+            acceleration = context.verletAcceleration;
+        else
+            acceleration = calculateAcceleration(state, context);
+
+        next.position = state.position + state.speed * timeStep + acceleration * (timeStep * timeStep / 2.0f);
+        // Friction depends on speed, so the new acceleration is evaluated with the predicted speed
+        const sf::Vector2f nextAcceleration = calculateAcceleration(PlayerState{next.position, state.speed + acceleration * timeStep}, context);
+        next.speed = state.speed + (acceleration + nextAcceleration) * (timeStep / 2.0f);
+
+        context.verletState = next;
+        context.verletAcceleration = nextAcceleration;
+        context.isVerletCacheValid = true;
+        break;
+    }
+    case Integrator::RK4:
+    {
+        // Derivative of position is speed, derivative of speed is acceleration
+        const sf::Vector2f k1Speed = state.speed;
+        const sf::Vector2f k1Acceleration = calculateAcceleration(state, context);
+        const sf::Vector2f k2Speed = state.speed + k1Acceleration * (timeStep / 2.0f);
+        const sf::Vector2f k2Acceleration = calculateAcceleration(PlayerState{state.position + k1Speed * (timeStep / 2.0f), k2Speed}, context);
+        const sf::Vector2f k3Speed = state.speed + k2Acceleration * (timeStep / 2.0f);
+        const sf::Vector2f k3Acceleration = calculateAcceleration(PlayerState{state.position + k2Speed * (timeStep / 2.0f), k3Speed}, context);
+        const sf::Vector2f k4Speed = state.speed + k3Acceleration * timeStep;
+        const sf::Vector2f k4Acceleration = calculateAcceleration(PlayerState{state.position + k3Speed * timeStep, k4Speed}, context);
+
+        next.position = state.position + (k1Speed + 2.0f * k2Speed + 2.0f * k3Speed + k4Speed) * (timeStep / 6.0f);
+        next.speed = state.speed + (k1Acceleration + 2.0f * k2Acceleration + 2.0f * k3Acceleration + k4Acceleration) * (timeStep / 6.0f);
+        break;
+    }
+    case Integrator::RK45:
+        next = integrateAdaptive(state, timeStep, context);
+        break;
+    case Integrator::SemiImplicitEuler:
+    default:
+    {
+        // Speed is updated and limited first, position is advanced with the new speed
+        const sf::Vector2f acceleration = calculateAcceleration(state, context);
+        next.speed = clampSpeed(state.speed + acceleration * timeStep);
+        next.position = state.position + next.speed * timeStep;
+        break;
+    }
+    }
+    return next;
+}
+
+// Dormand-Prince 5(4): fifth order solution, the embedded fourth order one estimates the error
+PlayerState PhysicsEngine::integrateAdaptive(const PlayerState &state, const float timeStep, SimulationContext &context) const
+{
+    // Butcher tableau
+    static const float a21 = 1.0f / 5.0f;
+    static const float a31 = 3.0f / 40.0f, a32 = 9.0f / 40.0f;
+    static const float a41 = 44.0f / 45.0f, a42 = -56.0f / 15.0f, a43 = 32.0f / 9.0f;
+    static const float a51 = 19372.0f / 6561.0f, a52 = -25360.0f / 2187.0f, a53 = 64448.0f / 6561.0f, a54 = -212.0f / 729.0f;
+    static const float a61 = 9017.0f / 3168.0f, a62 = -355.0f / 33.0f, a63 = 46732.0f / 5247.0f, a64 = 49.0f / 176.0f, a65 = -5103.0f / 18656.0f;
+    static const float b1 = 35.0f / 384.0f, b3 = 500.0f / 1113.0f, b4 = 125.0f / 192.0f, b5 = -2187.0f / 6784.0f, b6 = 11.0f / 84.0f;
+    // Difference of the fifth and fourth order weights
+    static const float e1 = 71.0f / 57600.0f, e3 = -71.0f / 16695.0f, e4 = 71.0f / 1920.0f, e5 = -17253.0f / 339200.0f, e6 = 22.0f / 525.0f, e7 = -1.0f / 40.0f;
+
+    PlayerState current = state;
+    float remaining = timeStep;
+    float step = context.adaptiveStep > 0.0f ? std::min(context.adaptiveStep, remaining) : remaining;
+    while (remaining > 0.0f)
+    {
+        step = std::min(step, remaining);
+
+        // Stages, every stage has a position (speed) and a speed (acceleration) derivative
+        const sf::Vector2f k1p = current.speed;
+        const sf::Vector2f k1v = calculateAcceleration(current, context);
+        const sf::Vector2f k2p = current.speed + step * (a21 * k1v);
+        const sf::Vector2f k2v = calculateAcceleration(PlayerState{current.position + step * (a21 * k1p), k2p}, context);
+        const sf::Vector2f k3p = current.speed + step * (a31 * k1v + a32 * k2v);
+        const sf::Vector2f k3v = calculateAcceleration(PlayerState{current.position + step * (a31 * k1p + a32 * k2p), k3p}, context);
+        const sf::Vector2f k4p = current.speed + step * (a41 * k1v + a42 * k2v + a43 * k3v);
+        const sf::Vector2f k4v = calculateAcceleration(PlayerState{current.position + step * (a41 * k1p + a42 * k2p + a43 * k3p), k4p}, context);
+        const sf::Vector2f k5p = current.speed + step * (a51 * k1v + a52 * k2v + a53 * k3v + a54 * k4v);
+        const sf::Vector2f k5v = calculateAcceleration(PlayerState{current.position + step * (a51 * k1p + a52 * k2p + a53 * k3p + a54 * k4p), k5p}, context);
+        const sf::Vector2f k6p = current.speed + step * (a61 * k1v + a62 * k2v + a63 * k3v + a64 * k4v + a65 * k5v);
+        const sf::Vector2f k6v = calculateAcceleration(PlayerState{current.position + step * (a61 * k1p + a62 * k2p + a63 * k3p + a64 * k4p + a65 * k5p), k6p}, context);
+
+        PlayerState next;
+        next.position = current.position + step * (b1 * k1p + b3 * k3p + b4 * k4p + b5 * k5p + b6 * k6p);
+        next.speed = current.speed + step * (b1 * k1v + b3 * k3v + b4 * k4v + b5 * k5v + b6 * k6v);
+        const sf::Vector2f k7p = next.speed;
+        const sf::Vector2f k7v = calculateAcceleration(next, context);
+
+        // Error estimate, relative to the tolerance (mixed absolute and relative scale)
+        const sf::Vector2f positionError = step * (e1 * k1p + e3 * k3p + e4 * k4p + e5 * k5p + e6 * k6p + e7 * k7p);
+        const sf::Vector2f speedError = step * (e1 * k1v + e3 * k3v + e4 * k4v + e5 * k5v + e6 * k6v + e7 * k7v);
+        const float speedScale = adaptiveTolerance * (1.0f + std::max(std::abs(next.speed.x), std::abs(next.speed.y)));
+        const float error = std::max(std::max(std::abs(positionError.x), std::abs(positionError.y)) / adaptiveTolerance,
+                                     std::max(std::abs(speedError.x), std::abs(speedError.y)) / speedScale);
+
+        // Accept step if the error is small enough (or the step can't get any smaller)
+        const bool isAccepted = error <= 1.0f || step <= minAdaptiveTimeStep;
+        if (isAccepted)
+        {
+            current = next;
+            remaining -= step;
+        }
+
+        // Next step length from the error, with a safety factor and limited growth
+        const float factor = error > 0.0f ? 0.9f * std::pow(error, -0.2f) : 5.0f;
+        step = std::max(minAdaptiveTimeStep, step * std::min(5.0f, std::max(0.2f, factor)));
+        if (isAccepted)
+            context.adaptiveStep = step;
+    }
+    return current;
+}
+
+// Check collision of the player with obstacles and walls
+bool PhysicsEngine::checkCollision(PlayerState &state, const sf::Vector2f &start, const float playerRadius) const
+{
+    // Check the obstacles near the path of the step, a hit is a distance from the path less than the sum of the radii
+    const bool isHit = collisionHash.overlapsSegment(start, state.position, playerRadius);
+
+    // Check collision with walls of the level, simulate perfectly elastic collision, where walls have infinite weight
+    // So just set the corresponding component of player's speed to its opposite
+    if (state.position.x < 0 || state.position.x > bounds.x)
+        state.speed.x = -state.speed.x;
+    if (state.position.y < 0 || state.position.y > bounds.y)
+        state.speed.y = -state.speed.y;
+
+    return isHit;
+}
+
+// Advance a simulation context by a fixed time step, only reads the engine
+bool PhysicsEngine::advance(SimulationContext &simulation, const float timeStep) const
+{
+    // Advance player with the selected integrator
+    const sf::Vector2f start = simulation.state.position;
+    simulation.state = integrate(simulation.state, timeStep, simulation);
+    return finishStep(simulation, start);
+}
+
+// Limit speed and check collisions after the state has been advanced
+bool PhysicsEngine::finishStep(SimulationContext &simulation, const sf::Vector2f &start) const
+{
+    // Don't let speed go above maximum speed for stability of simulation
+    PlayerState &state = simulation.state;
+    state.speed = clampSpeed(state.speed);
 
-    // Update player movement
-    player.updateMovement(acceleration);
-    
     // And check for collisions
-    checkCollision();
-}
\ No newline at end of file
+    simulation.isHit = checkCollision(state, start, simulation.traits.collisionRadius);
+    simulation.steps++;
+    return simulation.isHit;
+}
+
+// Advance several simulation contexts in lockstep, in groups of at most simulationLaneCount
+void PhysicsEngine::advanceLanes(SimulationContext *const *simulations, const size_t count, const float timeStep) const
+{
+    // Substeps of the adaptive integrator differ between the players
+    if (integrator == Integrator::RK45)
+    {
+        for (size_t i = 0; i < count; i++)
+            advance(*simulations[i], timeStep);
+        return;
+    }
+
+    PlayerState next[simulationLaneCount];
+    for (size_t first = 0; first < count; first += simulationLaneCount)
+    {
+        const size_t laneCount = std::min(simulationLaneCount, count - first);
+        integrateLanes(simulations + first, laneCount, timeStep, next);
+        for (size_t lane = 0; lane < laneCount; lane++)
+        {
+            const sf::Vector2f start = simulations[first + lane]->state.position;
+            simulations[first + lane]->state = next[lane];
+            finishStep(*simulations[first + lane], start);
+        }
+    }
+}
+
+// Advance player by a fixed time step
+bool PhysicsEngine::step(PlayerState &state, const float timeStep)
+{
+    // Update solver data structures if the obstacles or the size of the level changed since the last step
+    const unsigned long revision = preparedRevision;
+    synchronize();
+    if (preparedRevision != revision)
+        playerContext.invalidateCache();
+
+    // The state may have been changed from outside since the last step (teleported, zeroed speed)
+    playerContext.state = state;
+    const bool isHit = advance(playerContext, timeStep);
+    state = playerContext.state;
+    return isHit;
+}
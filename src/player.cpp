@@ -8,7 +8,6 @@
 
 extern const char debug;
 extern const float playerMaxSpeed;
-extern float deltaTime;
 
 extern sf::RenderWindow window;
 
@@ -19,6 +18,7 @@ Player::Player(float radius, double charge, double mass, sf::Vector2f pos)
     // Color of player is white
     body->setFillColor(sf::Color::White);
     body->setTexture(animation.getTexture());
+    body->setTextureRect(animation.getTextureRect());
 
     // Set position with setter to get protection for out of bounds type of stuff
     body->setOrigin(radius * 4.0f, radius * 4.0f);
@@ -37,6 +37,9 @@ void Player::setPosition(sf::Vector2f &newPos)
     else if (newPos.y > window.getSize().y)
         newPos.y = window.getSize().y;
 
+    // Teleporting is not interpolated
+    position = newPos;
+    previousPosition = newPos;
     body->setPosition(newPos);
 }
 
@@ -54,33 +57,26 @@ void Player::setSpeed(const sf::Vector2f &newSpeed)
         speed.y = -playerMaxSpeed;
 }
 
-// Updates speed with acceleration and deltaTime
-void Player::updateMovement(const sf::Vector2f &acceleration)
+// Updates speed and position with the result of the integrator
+void Player::updateMovement(const PlayerState &newState)
 {
-    // Limit maximum deltaTime to prevent bugs relating to too long deltaTime.
-    // For example if simulation stops because of resize or window dragging events,
-    // the simulation clock doesn't stop.
-    deltaTime = std::min(deltaTime, 0.0165f);
-    if (debug == 1)
-        std::cout << "dT:\t" << deltaTime << std::endl;
-
-    // Calculate new speed by adding change of speed to last speed
-    // (basically integrating the acceleration as a function of time)
-    sf::Vector2f newSpeed(speed.x + acceleration.x * deltaTime, speed.y += acceleration.y * deltaTime);
-    setSpeed(newSpeed);
+    setSpeed(newState.speed);
 
     if (debug == 2)
         std::cout << "Current speed\t" << std::sqrt(speed.x * speed.x + speed.y * speed.y) << "\tx: "
                   << speed.x << "\ty: " << speed.y << "\t\t";
 
-    // Calculate deltaPos the same way speed is calculated
-    sf::Vector2f deltaPos(0.0, 0.0);
-    deltaPos.x = speed.x * deltaTime;
-    deltaPos.y = speed.y * deltaTime;
+    // Update simulated position, remember last one for interpolation
+    previousPosition = position;
+    position = newState.position;
+    body->setPosition(position);
+}
 
-    // Update players position with deltaPos
-    body->move(deltaPos);
+// Place body between the last two simulated positions
+void Player::interpolate(const float alpha)
+{
+    body->setPosition(previousPosition + (position - previousPosition) * alpha);
 
-    // Update player animation
+    // Update player animation once per rendered frame
     animation.applyTransform(*this);
 }
\ No newline at end of file
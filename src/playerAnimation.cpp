@@ -5,7 +5,6 @@
 
 PlayerAnimation::PlayerAnimation() : Animation(Animation::Type::Player)
 {
-    texture = playerTexture;
 }
 
 void PlayerAnimation::applyTransform(Charge &toTransform) const
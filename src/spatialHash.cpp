@@ -0,0 +1,208 @@
+#include <SFML\System.hpp>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include "spatialHash.h"
+
+namespace
+{
+    // Cell coordinates are clamped to this, so the cast can't overflow and the size of a range fits in 64 bits
+    const int32_t maxCell = 1 << 29;
+}
+
+// Constructor
+SpatialHash::SpatialHash(const float cellSize)
+    : cellSize(cellSize), maxRadius(0.0f), count(0)
+{
+}
+
+// Cells are half open, so every coordinate belongs to exactly one, NaN fails both comparisons and lands in the first cell
+int32_t SpatialHash::toCell(const float coordinate) const
+{
+    const float cell = std::floor(coordinate / cellSize);
+    if (!(cell > -maxCell))
+        return -maxCell;
+    return cell < maxCell ? static_cast<int32_t>(cell) : maxCell;
+}
+
+// A huge box visits the non empty cells instead of looping over every cell of it
+SpatialHash::CellRange SpatialHash::getCellRange(const sf::Vector2f &min, const sf::Vector2f &max) const
+{
+    CellRange range;
+    range.firstColumn = toCell(min.x);
+    range.lastColumn = toCell(max.x);
+    range.firstRow = toCell(min.y);
+    range.lastRow = toCell(max.y);
+    const uint64_t columns = static_cast<uint64_t>(static_cast<int64_t>(range.lastColumn) - range.firstColumn + 1);
+    const uint64_t rows = static_cast<uint64_t>(static_cast<int64_t>(range.lastRow) - range.firstRow + 1);
+    range.isEveryCell = columns * rows > cells.size();
+    return range;
+}
+
+// Column in the high half, row in the low half
+uint64_t SpatialHash::toKey(const int32_t column, const int32_t row)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(column)) << 32) | static_cast<uint32_t>(row);
+}
+
+// Append circle to the cell of its center
+void SpatialHash::insert(const size_t index, const sf::Vector2f &pos, const float radius)
+{
+    cells[toKey(toCell(pos.x), toCell(pos.y))].push_back(Entry{index, pos.x, pos.y, radius});
+    maxRadius = std::max(maxRadius, radius);
+    count++;
+}
+
+// Swap-and-pop the circle from its cell, empty cells are dropped
+bool SpatialHash::remove(const size_t index, const sf::Vector2f &pos)
+{
+    const auto cell = cells.find(toKey(toCell(pos.x), toCell(pos.y)));
+    if (cell == cells.end())
+        return false;
+
+    std::vector<Entry> &entries = cell->second;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (entries[i].index != index)
+            continue;
+        entries[i] = entries.back();
+        entries.pop_back();
+        if (entries.empty())
+            cells.erase(cell);
+        count--;
+        return true;
+    }
+    return false;
+}
+
+// Swap-and-pop the first circle of the cell with the same center and radius
+bool SpatialHash::removeCircle(const sf::Vector2f &pos, const float radius)
+{
+    const auto cell = cells.find(toKey(toCell(pos.x), toCell(pos.y)));
+    if (cell == cells.end())
+        return false;
+
+    std::vector<Entry> &entries = cell->second;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (entries[i].x != pos.x || entries[i].y != pos.y || entries[i].radius != radius)
+            continue;
+        entries[i] = entries.back();
+        entries.pop_back();
+        if (entries.empty())
+            cells.erase(cell);
+        count--;
+        return true;
+    }
+    return false;
+}
+
+// The circle stays in its cell, only its index changes
+bool SpatialHash::rename(const size_t oldIndex, const size_t newIndex, const sf::Vector2f &pos)
+{
+    const auto cell = cells.find(toKey(toCell(pos.x), toCell(pos.y)));
+    if (cell == cells.end())
+        return false;
+
+    for (Entry &entry : cell->second)
+    {
+        if (entry.index != oldIndex)
+            continue;
+        entry.index = newIndex;
+        return true;
+    }
+    return false;
+}
+
+// Clear all cells
+void SpatialHash::clear()
+{
+    cells.clear();
+    maxRadius = 0.0f;
+    count = 0;
+}
+
+// Visit the cells any overlapping circle can have its center in, then test the circles exactly
+void SpatialHash::queryRadius(const sf::Vector2f &center, const float radius, std::vector<size_t> &result) const
+{
+    if (count == 0 || !std::isfinite(center.x) || !std::isfinite(center.y) || !std::isfinite(radius))
+        return;
+
+    const auto testCell = [&](const std::vector<Entry> &entries)
+    {
+        for (const Entry &entry : entries)
+        {
+            const float dx = entry.x - center.x;
+            const float dy = entry.y - center.y;
+            const float distance = radius + entry.radius;
+            if (dx * dx + dy * dy <= distance * distance)
+                result.push_back(entry.index);
+        }
+    };
+
+    const float reach = radius + maxRadius;
+    const CellRange range = getCellRange(center - sf::Vector2f(reach, reach), center + sf::Vector2f(reach, reach));
+    if (range.isEveryCell)
+    {
+        for (const auto &cell : cells)
+            testCell(cell.second);
+        return;
+    }
+    for (int32_t column = range.firstColumn; column <= range.lastColumn; column++)
+        for (int32_t row = range.firstRow; row <= range.lastRow; row++)
+        {
+            const auto cell = cells.find(toKey(column, row));
+            if (cell != cells.end())
+                testCell(cell->second);
+        }
+}
+
+// Visit the cells of the bounding box of the swept circle, stop at the first circle closer to the segment than the radii
+// A segment that isn't finite comes from a diverged step, it is reported as a hit so the run stops
+bool SpatialHash::overlapsSegment(const sf::Vector2f &start, const sf::Vector2f &end, const float radius) const
+{
+    if (count == 0)
+        return false;
+    if (!std::isfinite(start.x) || !std::isfinite(start.y) || !std::isfinite(end.x) || !std::isfinite(end.y) || !std::isfinite(radius))
+        return true;
+
+    const sf::Vector2f segment = end - start;
+    const float segmentLengthSquared = segment.x * segment.x + segment.y * segment.y;
+    const auto testCell = [&](const std::vector<Entry> &entries)
+    {
+        for (const Entry &entry : entries)
+        {
+            // Closest point of the segment to the center of the circle
+            float t = 0.0f;
+            if (segmentLengthSquared > 0.0f)
+                t = std::clamp(((entry.x - start.x) * segment.x + (entry.y - start.y) * segment.y) / segmentLengthSquared, 0.0f, 1.0f);
+            const float dx = entry.x - (start.x + t * segment.x);
+            const float dy = entry.y - (start.y + t * segment.y);
+            const float distance = radius + entry.radius;
+            if (dx * dx + dy * dy < distance * distance)
+                return true;
+        }
+        return false;
+    };
+
+    const float reach = radius + maxRadius;
+    const CellRange range = getCellRange(sf::Vector2f(std::min(start.x, end.x) - reach, std::min(start.y, end.y) - reach),
+                                         sf::Vector2f(std::max(start.x, end.x) + reach, std::max(start.y, end.y) + reach));
+    if (range.isEveryCell)
+    {
+        for (const auto &cell : cells)
+            if (testCell(cell.second))
+                return true;
+        return false;
+    }
+    for (int32_t column = range.firstColumn; column <= range.lastColumn; column++)
+        for (int32_t row = range.firstRow; row <= range.lastRow; row++)
+        {
+            const auto cell = cells.find(toKey(column, row));
+            if (cell != cells.end() && testCell(cell->second))
+                return true;
+        }
+    return false;
+}
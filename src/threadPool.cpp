@@ -0,0 +1,92 @@
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+#include "threadPool.h"
+
+// Start one worker less than requested, the calling thread is the last one
+ThreadPool::ThreadPool(unsigned threadCount)
+    : job(nullptr), jobCount(0), grainSize(1), nextIndex(0), busyWorkers(0), generation(0), isStopping(false)
+{
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    workers.reserve(threadCount - 1);
+    for (unsigned i = 1; i < threadCount; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+// Wake workers with the stop flag set and wait for them
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isStopping = true;
+    }
+    wakeCondition.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+// Sleep until a new job is published, work on it, report when done
+void ThreadPool::workerLoop()
+{
+    unsigned long seenGeneration = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        wakeCondition.wait(lock, [this, seenGeneration]
+                           { return isStopping || generation != seenGeneration; });
+        if (isStopping)
+            return;
+        seenGeneration = generation;
+
+        lock.unlock();
+        runChunks();
+        lock.lock();
+
+        // The caller waits for every worker, so no worker can miss a job
+        if (--busyWorkers == 0)
+            doneCondition.notify_all();
+    }
+}
+
+// Claim chunks from the shared counter until the job is exhausted
+void ThreadPool::runChunks()
+{
+    while (true)
+    {
+        const size_t begin = nextIndex.fetch_add(grainSize);
+        if (begin >= jobCount)
+            return;
+        (*job)(begin, std::min(begin + grainSize, jobCount));
+    }
+}
+
+// Publish job, work on it on the calling thread too, wait for the workers
+void ThreadPool::parallelFor(const size_t count, const size_t grain, const std::function<void(size_t, size_t)> &function)
+{
+    if (count == 0)
+        return;
+
+    std::lock_guard<std::mutex> runLock(runMutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &function;
+        jobCount = count;
+        grainSize = std::max<size_t>(1, grain);
+        nextIndex = 0;
+        busyWorkers = static_cast<unsigned>(workers.size());
+        generation++;
+    }
+    wakeCondition.notify_all();
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this]
+                       { return busyWorkers == 0; });
+    job = nullptr;
+}
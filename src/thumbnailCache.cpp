@@ -0,0 +1,231 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+
+#include "thumbnailCache.h"
+#include "levelManager.h"
+#include "levelFormat.h"
+#include "settings.h"
+
+extern const char debug;
+
+// Constructor, the worker is started by the first request
+ThumbnailCache::ThumbnailCache()
+    : isStopping(false), isRendering(false)
+{
+}
+
+// Wake the worker with the stop flag set and wait for it
+ThumbnailCache::~ThumbnailCache()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isStopping = true;
+    }
+    wakeCondition.notify_all();
+    if (worker.joinable())
+        worker.join();
+}
+
+// Path of the saved preview of a level
+std::string ThumbnailCache::getThumbnailPath(const std::string &levelName)
+{
+    return "./levels/thumbnails/" + levelName + ".thumb";
+}
+
+// Return the preview if it belongs to the current version of the level, queue it otherwise
+std::shared_ptr<const Thumbnail> ThumbnailCache::request(const LevelInfo &info)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(info.name);
+        if (it != entries.end() && it->second.checksum == info.checksum && it->second.journalSize == info.journalSize)
+            return it->second.image;
+
+        // Replace the job of an older version of the level
+        entries[info.name] = Entry{info.checksum, info.journalSize, nullptr};
+        jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [&info](const Job &job)
+                                  { return job.name == info.name; }),
+                   jobs.end());
+        jobs.push_back(Job{info.name, LevelManager::getLevelPath(info.name, info.format), info.checksum, info.journalSize});
+
+        if (!worker.joinable())
+            worker = std::thread(&ThumbnailCache::workerLoop, this);
+    }
+    wakeCondition.notify_one();
+    return nullptr;
+}
+
+// Nothing queued and nothing in progress
+bool ThumbnailCache::isIdle()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.empty() && !isRendering;
+}
+
+// Drop the preview and its file
+void ThumbnailCache::forget(const std::string &levelName)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.erase(levelName);
+        jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [&levelName](const Job &job)
+                                  { return job.name == levelName; }),
+                   jobs.end());
+    }
+    std::error_code error;
+    std::filesystem::remove(getThumbnailPath(levelName), error);
+}
+
+// Take the latest job, make its preview without holding the lock, publish it if the level hasn't changed meanwhile
+void ThumbnailCache::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        wakeCondition.wait(lock, [this]
+                           { return isStopping || !jobs.empty(); });
+        if (isStopping)
+            return;
+
+        const Job job = jobs.back();
+        jobs.pop_back();
+        isRendering = true;
+        lock.unlock();
+
+        // Level files are only read if the saved preview is missing or outdated
+        std::shared_ptr<const Thumbnail> image = readThumbnail(job);
+        if (!image)
+        {
+            try
+            {
+                std::shared_ptr<Thumbnail> rendered = std::make_shared<Thumbnail>(
+                    renderThumbnail(LevelManager::readSavedLevel(job.name, job.path, nullptr), thumbnailWidth, thumbnailHeight));
+                writeThumbnail(job, *rendered);
+                image = rendered;
+                if (debug == 5)
+                    std::cout << "Rendered thumbnail of level: " + job.name << std::endl;
+            }
+            catch (const std::exception &e)
+            {
+                if (debug == 5)
+                    std::cout << "Couldn't render thumbnail of level " + job.name + ": " + e.what() << std::endl;
+            }
+        }
+
+        lock.lock();
+        isRendering = false;
+        auto it = entries.find(job.name);
+        if (it != entries.end() && it->second.checksum == job.checksum && it->second.journalSize == job.journalSize)
+            it->second.image = image;
+    }
+}
+
+// Read the preview file, only if it matches the version of the level and the size of the previews
+std::shared_ptr<const Thumbnail> ThumbnailCache::readThumbnail(const Job &job)
+{
+    std::ifstream thumbnailFile(getThumbnailPath(job.name), std::ios::binary);
+    if (!thumbnailFile)
+        return nullptr;
+
+    ThumbnailHeader header;
+    if (!thumbnailFile.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, thumbnailMagic, sizeof(thumbnailMagic)) != 0 || header.version != thumbnailVersion ||
+        header.checksum != job.checksum || header.journalSize != job.journalSize ||
+        header.width != thumbnailWidth || header.height != thumbnailHeight)
+        return nullptr;
+
+    std::shared_ptr<Thumbnail> image = std::make_shared<Thumbnail>();
+    image->width = header.width;
+    image->height = header.height;
+    image->pixels.resize(static_cast<size_t>(header.width) * header.height * 4);
+    if (!thumbnailFile.read(reinterpret_cast<char *>(image->pixels.data()), image->pixels.size()))
+        return nullptr;
+    return image;
+}
+
+// Write the preview to a new file and rename it over the old one
+void ThumbnailCache::writeThumbnail(const Job &job, const Thumbnail &image)
+{
+    std::error_code error;
+    std::filesystem::create_directories("./levels/thumbnails", error);
+
+    const std::string path = getThumbnailPath(job.name);
+    const std::string temporaryPath = path + ".tmp";
+    std::ofstream thumbnailFile(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!thumbnailFile)
+        return;
+
+    ThumbnailHeader header;
+    std::memcpy(header.magic, thumbnailMagic, sizeof(thumbnailMagic));
+    header.version = thumbnailVersion;
+    header.width = image.width;
+    header.height = image.height;
+    header.checksum = job.checksum;
+    header.journalSize = job.journalSize;
+    thumbnailFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    thumbnailFile.write(reinterpret_cast<const char *>(image.pixels.data()), image.pixels.size());
+    thumbnailFile.close();
+    if (!thumbnailFile)
+        return;
+
+    std::filesystem::rename(temporaryPath, path, error);
+}
+
+// Sum the charges covering every pixel, then color the pixels by the sign and relative size of their sum
+Thumbnail ThumbnailCache::renderThumbnail(const LevelData &data, const unsigned width, const unsigned height)
+{
+    std::vector<float> sums(static_cast<size_t>(width) * height, 0.0f);
+    const float scaleX = static_cast<float>(width) / std::max(1u, data.size.x);
+    const float scaleY = static_cast<float>(height) / std::max(1u, data.size.y);
+    const float *x = data.charges.getX();
+    const float *y = data.charges.getY();
+    const float *q = data.charges.getCharge();
+    const float *r = data.charges.getCollisionRadius();
+    for (size_t i = 0; i < data.charges.size(); i++)
+    {
+        // Every charge covers at least the pixel of its center
+        const long centerX = std::clamp(static_cast<long>(x[i] * scaleX), 0L, static_cast<long>(width) - 1);
+        const long centerY = std::clamp(static_cast<long>(y[i] * scaleY), 0L, static_cast<long>(height) - 1);
+        const long radiusX = static_cast<long>(r[i] * scaleX);
+        const long radiusY = static_cast<long>(r[i] * scaleY);
+        for (long py = std::max(0L, centerY - radiusY); py <= std::min(static_cast<long>(height) - 1, centerY + radiusY); py++)
+            for (long px = std::max(0L, centerX - radiusX); px <= std::min(static_cast<long>(width) - 1, centerX + radiusX); px++)
+            {
+                const float dx = radiusX == 0 ? 0.0f : static_cast<float>(px - centerX) / radiusX;
+                const float dy = radiusY == 0 ? 0.0f : static_cast<float>(py - centerY) / radiusY;
+                if (dx * dx + dy * dy <= 1.0f)
+                    sums[py * width + px] += q[i];
+            }
+    }
+
+    float maxSum = 0.0f;
+    for (const float sum : sums)
+        maxSum = std::max(maxSum, std::abs(sum));
+
+    // Pixels without charge are dark grey, a single weak charge still shows at half brightness
+    Thumbnail image{width, height, std::vector<uint8_t>(sums.size() * 4)};
+    for (size_t i = 0; i < sums.size(); i++)
+    {
+        uint8_t *pixel = &image.pixels[i * 4];
+        pixel[0] = pixel[1] = pixel[2] = 24;
+        pixel[3] = 255;
+        if (sums[i] == 0.0f)
+            continue;
+
+        const uint8_t intensity = static_cast<uint8_t>(255.0f * (0.5f + 0.5f * std::sqrt(std::abs(sums[i]) / maxSum)));
+        if (sums[i] > 0.0f)
+            pixel[0] = intensity;
+        else
+            pixel[2] = intensity;
+    }
+    return image;
+}
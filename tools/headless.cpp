@@ -0,0 +1,308 @@
+#include <SFML\System.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "levelManager.h"
+#include "levelData.h"
+#include "physics.h"
+#include "playerState.h"
+#include "simulationContext.h"
+#include "batchEvaluator.h"
+#include "forceKernel.h"
+#include "settings.h"
+
+// Headless simulation runner
+// Loads a level through LevelManager and simulates the player without a window, textures or the game objects.
+// Only the physics sources (physics, spatialHash, chargeStore, forceKernel, chargeQuadtree, fieldGrid, threadPool, batchEvaluator, levelManager, mappedFile and compression)
+// have to be compiled with this file, linking sfml-system is enough.
+//
+// Usage: headless --check-kernels
+//   Runs every force kernel the CPU supports on the same random charges and compares them to the scalar kernel,
+//   exit code is 0 if they agree and 1 otherwise. No level is loaded.
+//
+// Usage: headless <level name> [options]
+//   --start <x> <y>        Start position of the player, default is the start position of the level
+//   --speed <vx> <vy>      Launch velocity of the player, default is 0 0
+//   --steps <n>            Maximum number of simulation steps, default is 10 seconds of simulated time
+//   --dt <seconds>         Length of a simulation step, default is simulationTimeStep
+//   --solver <n>           0: direct, 1: Barnes-Hut, 2: field grid (see PHYSICS SOLVERS in settings.h)
+//   --integrator <n>       See INTEGRATORS in settings.h
+//   --trace <k>            Print the state of the player after every k-th step as CSV
+//   --sweep <n>            Launch n players in every direction with the length of --speed on every core,
+//                          print the outcome of each as CSV
+//   --threads <n>          Number of threads used by --sweep, default is one per core
+//
+// Exit code is 0 if the player survived every step, 2 if it hit an obstacle and 1 on errors.
+
+namespace
+{
+    // Print usage to cerr
+    void printUsage()
+    {
+        std::cerr << "Usage: headless <level name> [--start x y] [--speed vx vy] [--steps n] [--dt seconds]"
+                  << " [--solver 0|1|2] [--integrator 0-4] [--trace k] [--sweep n] [--threads n]" << std::endl
+                  << "       headless --check-kernels" << std::endl;
+    }
+
+    // Check that an option has enough arguments after it
+    bool hasArguments(const int argc, const int idx, const int count)
+    {
+        if (idx + count < argc)
+            return true;
+        std::cerr << "Missing argument after option" << std::endl;
+        return false;
+    }
+
+    // Relative error of a kernel result, measured against the sum of the magnitudes of the summed terms,
+    // so cancelling charges of mixed signs don't turn rounding into a large relative error
+    double getKernelError(const float value, const float reference, const double scale)
+    {
+        if (!std::isfinite(reference))
+            return std::isfinite(value) ? INFINITY : 0.0;
+        return std::abs(static_cast<double>(value) - reference) / std::max(scale, 1e-30);
+    }
+
+    // Sums of the magnitudes of the field and the potential terms at a position, in double
+    void getTermScales(const std::vector<float> &x, const std::vector<float> &y, const std::vector<float> &q, const size_t count,
+                       const float posX, const float posY, const float softening, double &fieldScale, double &potentialScale)
+    {
+        fieldScale = potentialScale = 0.0;
+        for (size_t i = 0; i < count; i++)
+        {
+            const double riX = x[i] - posX;
+            const double riY = y[i] - posY;
+            const double riLengthSquared = std::max(riX * riX + riY * riY + softening, 1e-12);
+            fieldScale += std::abs(q[i]) / riLengthSquared;
+            potentialScale += std::abs(q[i]) / std::sqrt(riLengthSquared);
+        }
+    }
+
+    // Compare every supported kernel to the scalar one on random charges of mixed signs, for every tail length
+    // of the vectorized loops and for partially filled tiles of the lane kernels. Some positions lie exactly on a charge,
+    // there the unsoftened sums must be non-finite for every kernel and the softened ones must still agree.
+    int checkKernels()
+    {
+        const double tolerance = 1e-4;
+        const float softening = 1.0f;
+        std::mt19937 random(12345);
+        std::uniform_real_distribution<float> coordinate(0.0f, 1024.0f);
+        std::uniform_real_distribution<float> charge(-2000.0f, 2000.0f);
+
+        std::vector<size_t> counts;
+        for (size_t count = 0; count <= 33; count++)
+            counts.push_back(count);
+        for (size_t count = 1000; count <= 1009; count++)
+            counts.push_back(count);
+
+        std::vector<ForceKernel> kernels;
+        for (const ForceKernel kernel : {ForceKernel::Scalar, ForceKernel::SSE4, ForceKernel::AVX2})
+            if (static_cast<int>(kernel) <= static_cast<int>(detectForceKernel()))
+                kernels.push_back(kernel);
+
+        bool isPassed = true;
+        for (const ForceKernel kernel : kernels)
+        {
+            double maxFieldError = 0.0, maxLaneError = 0.0, maxPotentialError = 0.0;
+            for (const size_t count : counts)
+            {
+                std::vector<float> x(count), y(count), q(count);
+                for (size_t i = 0; i < count; i++)
+                {
+                    x[i] = coordinate(random);
+                    y[i] = coordinate(random);
+                    q[i] = charge(random);
+                }
+
+                // Positions of up to 19 lanes, every fifth lane on top of a charge
+                const size_t laneCount = 1 + count % 19;
+                std::vector<float> posX(laneCount), posY(laneCount);
+                for (size_t lane = 0; lane < laneCount; lane++)
+                {
+                    const bool isOnCharge = count != 0 && lane % 5 == 4;
+                    posX[lane] = isOnCharge ? x[lane % count] : coordinate(random);
+                    posY[lane] = isOnCharge ? y[lane % count] : coordinate(random);
+                }
+
+                std::vector<float> fieldX(laneCount), fieldY(laneCount), softX(laneCount), softY(laneCount), potential(laneCount);
+                std::vector<float> referenceSoftX(laneCount), referenceSoftY(laneCount), referencePotential(laneCount);
+                sumElectricFieldLanes(x.data(), y.data(), q.data(), count, posX.data(), posY.data(), laneCount, fieldX.data(), fieldY.data(), kernel);
+                sumFieldAndPotentialLanes(x.data(), y.data(), q.data(), count, posX.data(), posY.data(), laneCount, softening,
+                                          softX.data(), softY.data(), potential.data(), kernel);
+                sumFieldAndPotentialLanes(x.data(), y.data(), q.data(), count, posX.data(), posY.data(), laneCount, softening,
+                                          referenceSoftX.data(), referenceSoftY.data(), referencePotential.data(), ForceKernel::Scalar);
+
+                for (size_t lane = 0; lane < laneCount; lane++)
+                {
+                    const sf::Vector2f pos(posX[lane], posY[lane]);
+                    const sf::Vector2f reference = sumElectricFieldScalar(x.data(), y.data(), q.data(), count, pos);
+                    const sf::Vector2f field = sumElectricField(x.data(), y.data(), q.data(), count, pos, kernel);
+                    double scale, softScale, potentialScale;
+                    getTermScales(x, y, q, count, pos.x, pos.y, 0.0f, scale, potentialScale);
+                    maxFieldError = std::max({maxFieldError, getKernelError(field.x, reference.x, scale), getKernelError(field.y, reference.y, scale)});
+                    maxLaneError = std::max({maxLaneError, getKernelError(fieldX[lane], reference.x, scale), getKernelError(fieldY[lane], reference.y, scale)});
+
+                    getTermScales(x, y, q, count, pos.x, pos.y, softening, softScale, potentialScale);
+                    maxPotentialError = std::max({maxPotentialError, getKernelError(softX[lane], referenceSoftX[lane], softScale),
+                                                  getKernelError(softY[lane], referenceSoftY[lane], softScale),
+                                                  getKernelError(potential[lane], referencePotential[lane], potentialScale)});
+                    if (!std::isfinite(softX[lane]) || !std::isfinite(potential[lane]))
+                        maxPotentialError = INFINITY;
+                }
+            }
+
+            const bool isKernelPassed = maxFieldError <= tolerance && maxLaneError <= tolerance && maxPotentialError <= tolerance;
+            std::cout << getForceKernelName(kernel) << ": field " << maxFieldError << ", lanes " << maxLaneError
+                      << ", field and potential " << maxPotentialError << (isKernelPassed ? " ok" : " FAILED") << std::endl;
+            isPassed = isPassed && isKernelPassed;
+        }
+        return isPassed ? 0 : 1;
+    }
+
+    // Launch players in every direction in parallel, print the outcome of each
+    int runSweep(const PhysicsEngine &physics, const PlayerState &start, const unsigned long count, const unsigned threadCount,
+                 const float timeStep, const unsigned long maxSteps)
+    {
+        const float speed = std::sqrt(start.speed.x * start.speed.x + start.speed.y * start.speed.y);
+        std::vector<SimulationContext> simulations;
+        simulations.reserve(count);
+        for (unsigned long i = 0; i < count; i++)
+        {
+            const float angle = 2.0f * static_cast<float>(M_PI) * i / count;
+            simulations.emplace_back(PlayerState{start.position, sf::Vector2f(speed * std::cos(angle), speed * std::sin(angle))});
+        }
+
+        BatchEvaluator evaluator(threadCount);
+        const auto begin = std::chrono::steady_clock::now();
+        evaluator.run(physics, simulations, timeStep, maxSteps);
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        std::cout << "run,vx,vy,steps,outcome,x,y" << std::endl;
+        unsigned long totalSteps = 0;
+        unsigned long hitCount = 0;
+        for (unsigned long i = 0; i < count; i++)
+        {
+            const SimulationContext &simulation = simulations[i];
+            const float angle = 2.0f * static_cast<float>(M_PI) * i / count;
+            std::cout << i << ',' << speed * std::cos(angle) << ',' << speed * std::sin(angle) << ',' << simulation.steps << ','
+                      << (simulation.isHit ? "collision" : "survived") << ',' << simulation.state.position.x << ',' << simulation.state.position.y << std::endl;
+            totalSteps += simulation.steps;
+            hitCount += simulation.isHit;
+        }
+
+        std::cerr << count << " runs on " << evaluator.getThreadCount() << " threads, " << hitCount << " collisions, "
+                  << (elapsed > 0.0 ? totalSteps / elapsed : 0.0) << " steps/s" << std::endl;
+        return 0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || std::strcmp(argv[1], "--help") == 0)
+    {
+        printUsage();
+        return 1;
+    }
+    if (std::strcmp(argv[1], "--check-kernels") == 0)
+        return checkKernels();
+
+    // Load the level without creating obstacles
+    LevelData data;
+    try
+    {
+        data = LevelManager::getInstance()->loadLevelData(argv[1]);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    PlayerState state{data.playerStartPos, sf::Vector2f(0.0f, 0.0f)};
+    float timeStep = simulationTimeStep;
+    unsigned long maxSteps = 0;
+    unsigned long traceInterval = 0;
+    unsigned long sweepCount = 0;
+    unsigned threadCount = 0;
+    PhysicsEngine physics;
+
+    // Parse options
+    for (int i = 2; i < argc; i++)
+    {
+        const std::string option(argv[i]);
+        if (option == "--start" && hasArguments(argc, i, 2))
+        {
+            state.position = sf::Vector2f(std::strtof(argv[i + 1], nullptr), std::strtof(argv[i + 2], nullptr));
+            i += 2;
+        }
+        else if (option == "--speed" && hasArguments(argc, i, 2))
+        {
+            state.speed = sf::Vector2f(std::strtof(argv[i + 1], nullptr), std::strtof(argv[i + 2], nullptr));
+            i += 2;
+        }
+        else if (option == "--steps" && hasArguments(argc, i, 1))
+            maxSteps = std::strtoul(argv[++i], nullptr, 10);
+        else if (option == "--dt" && hasArguments(argc, i, 1))
+            timeStep = std::strtof(argv[++i], nullptr);
+        else if (option == "--solver" && hasArguments(argc, i, 1))
+            physics.setSolver(static_cast<PhysicsEngine::Solver>(std::atoi(argv[++i])));
+        else if (option == "--integrator" && hasArguments(argc, i, 1))
+            physics.setIntegrator(static_cast<PhysicsEngine::Integrator>(std::atoi(argv[++i])));
+        else if (option == "--trace" && hasArguments(argc, i, 1))
+            traceInterval = std::strtoul(argv[++i], nullptr, 10);
+        else if (option == "--sweep" && hasArguments(argc, i, 1))
+            sweepCount = std::strtoul(argv[++i], nullptr, 10);
+        else if (option == "--threads" && hasArguments(argc, i, 1))
+            threadCount = std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+    if (timeStep <= 0.0f)
+    {
+        std::cerr << "Time step must be positive" << std::endl;
+        return 1;
+    }
+    if (maxSteps == 0)
+        maxSteps = static_cast<unsigned long>(10.0f / timeStep);
+
+    // The player of the game is created with the default traits of the engine
+    physics.setCharges(data.charges, data.size);
+    physics.prepare();
+
+    if (sweepCount != 0)
+        return runSweep(physics, state, sweepCount, threadCount, timeStep, maxSteps);
+
+    if (traceInterval != 0)
+        std::cout << "step,time,x,y,vx,vy" << std::endl;
+
+    // Simulate until collision or the step limit
+    const auto start = std::chrono::steady_clock::now();
+    unsigned long step = 0;
+    bool isHit = false;
+    while (step < maxSteps && !isHit)
+    {
+        isHit = physics.step(state, timeStep);
+        step++;
+        if (traceInterval != 0 && (step % traceInterval == 0 || isHit))
+            std::cout << step << ',' << step * timeStep << ',' << state.position.x << ',' << state.position.y << ','
+                      << state.speed.x << ',' << state.speed.y << std::endl;
+    }
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Report outcome and throughput
+    std::cout << (isHit ? "collision" : "survived") << " after " << step << " steps (" << step * timeStep << " s)"
+              << " at " << state.position.x << ' ' << state.position.y << std::endl;
+    std::cerr << data.charges.size() << " obstacles, " << physics.getForceEvaluationCount() << " force evaluations, "
+              << (elapsed > 0.0 ? step / elapsed : 0.0) << " steps/s" << std::endl;
+
+    return isHit ? 2 : 0;
+}
@@ -0,0 +1,240 @@
+#include <SFML\System.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+#include "levelManager.h"
+#include "levelData.h"
+#include "levelFormat.h"
+#include "nlohmann\json.hpp"
+
+// Level loading benchmark
+// Writes synthetic levels with 10^4, 10^5 and 10^6 obstacles into a temporary folder and measures how long loading
+// them takes with the old DOM based JSON loader, the streaming JSON loader, the binary and the compressed format.
+// Every level is written twice: with obstacles scattered randomly, and painted in strokes like levels made in the editor.
+// Every format is checked to load back the written level, compressed positions within their rounding. The compressed files of
+// 10^4 obstacles are also truncated, given unknown versions and corrupted, loading them has to throw std::runtime_error or give a level of the declared size.
+// Build it with -fsanitize=address to catch reads out of bounds as well.
+// Only levelManager.cpp, chargeStore.cpp, mappedFile.cpp and compression.cpp have to be compiled with this file, linking sfml-system is enough.
+//
+// Usage: levelBenchmark [repeats]
+//   repeats   Number of times every file is loaded, the fastest run is printed. Default is 3.
+
+namespace
+{
+    // The loader LevelManager used before the streaming one, kept as the reference
+    LevelData readJsonLevelDom(const std::string &path)
+    {
+        std::ifstream levelFile(path);
+        if (!levelFile)
+            throw std::runtime_error("Couldn't open " + path);
+        nlohmann::json jsonData;
+        levelFile >> jsonData;
+
+        LevelData data;
+        data.name = jsonData["name"];
+        data.size = sf::Vector2u(jsonData["size"]["x"], jsonData["size"]["y"]);
+        data.playerStartPos = sf::Vector2f(jsonData["playerStartPos"]["x"], jsonData["playerStartPos"]["y"]);
+        data.charges.reserve(jsonData["obstacles"].size());
+        for (const auto &obstacleData : jsonData["obstacles"])
+            data.charges.add(obstacleData["position"]["x"], obstacleData["position"]["y"], obstacleData["charge"], obstacleData["radius"]);
+        return data;
+    }
+
+    // A level with obstacles spread over the whole window
+    LevelData makeLevel(const size_t obstacleCount)
+    {
+        LevelData data;
+        data.name = "benchmark";
+        data.size = sf::Vector2u(1024, 512);
+        data.playerStartPos = sf::Vector2f(512.0f, 256.0f);
+        data.charges.reserve(obstacleCount);
+        std::srand(1);
+        for (size_t i = 0; i < obstacleCount; i++)
+            data.charges.add(std::rand() % 1024 + 0.5f, std::rand() % 512 + 0.25f, std::rand() % 2 ? 1500.0f : -1500.0f, 7.0f);
+        return data;
+    }
+
+    // A level painted like in the editor: strokes of identical charges a pixel apart
+    LevelData makePaintedLevel(const size_t obstacleCount)
+    {
+        LevelData data;
+        data.name = "benchmark";
+        data.size = sf::Vector2u(1024, 512);
+        data.playerStartPos = sf::Vector2f(512.0f, 256.0f);
+        data.charges.reserve(obstacleCount);
+        std::srand(1);
+        while (data.charges.size() < obstacleCount)
+        {
+            float x = static_cast<float>(std::rand() % 1024);
+            float y = static_cast<float>(std::rand() % 512);
+            const int stepX = std::rand() % 3 - 1;
+            const int stepY = std::rand() % 3 - 1;
+            const float charge = std::rand() % 2 ? 1500.0f : -1500.0f;
+            for (int i = 0; i < 200 && data.charges.size() < obstacleCount; i++)
+            {
+                data.charges.add(x, y, charge, 7.0f);
+                x += stepX;
+                y += stepY;
+            }
+        }
+        return data;
+    }
+
+    // Throw if a loaded level differs from the written one, positions may differ by the given tolerance
+    void checkRoundTrip(const LevelData &expected, const LevelData &loaded, const float positionTolerance, const std::string &format)
+    {
+        const ChargeStore &a = expected.charges;
+        const ChargeStore &b = loaded.charges;
+        if (loaded.name != expected.name || loaded.size != expected.size || loaded.playerStartPos != expected.playerStartPos || b.size() != a.size())
+            throw std::runtime_error(format + " level doesn't load back: header differs");
+        for (size_t i = 0; i < a.size(); i++)
+            if (std::abs(b.getX()[i] - a.getX()[i]) > positionTolerance || std::abs(b.getY()[i] - a.getY()[i]) > positionTolerance ||
+                b.getCharge()[i] != a.getCharge()[i] || b.getCollisionRadius()[i] != a.getCollisionRadius()[i])
+                throw std::runtime_error(format + " level doesn't load back: obstacle " + std::to_string(i) + " differs");
+    }
+
+    // Write bytes to a file
+    void writeBytes(const std::string &path, const std::vector<char> &bytes, const size_t size)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(bytes.data(), size);
+        if (!file)
+            throw std::runtime_error("Couldn't write " + path);
+    }
+
+    // Load a malformed level file, only std::runtime_error or a level of the declared size are accepted
+    // Returns whether it was rejected
+    bool loadMalformed(const std::string &path, const size_t declaredCount)
+    {
+        try
+        {
+            const LevelData data = LevelManager::readLevelFile(path);
+            if (data.charges.size() != declaredCount)
+                throw std::logic_error("Malformed level loaded with " + std::to_string(data.charges.size()) + " obstacles");
+            return false;
+        }
+        catch (const std::runtime_error &)
+        {
+            return true;
+        }
+    }
+
+    // Every truncation of a compressed level has to be rejected, corrupted bytes have to be rejected or decode to some level
+    void checkMalformedCompressed(const std::string &path, const size_t count)
+    {
+        std::ifstream file(path, std::ios::binary);
+        const std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        const std::string malformedPath = path + ".malformed.clvl";
+
+        // Cuts in the header, the name and all over the compressed payload
+        for (size_t size = 0; size < bytes.size(); size += size < 128 ? 1 : std::max<size_t>(1, bytes.size() / 256))
+        {
+            writeBytes(malformedPath, bytes, size);
+            if (!loadMalformed(malformedPath, count))
+                throw std::runtime_error("Compressed level truncated to " + std::to_string(size) + " bytes was loaded");
+        }
+
+        // Versions this program doesn't know
+        for (const uint32_t version : {0u, compressedLevelVersion + 1})
+        {
+            std::vector<char> changed(bytes);
+            std::memcpy(changed.data() + offsetof(CompressedLevelHeader, version), &version, sizeof(version));
+            writeBytes(malformedPath, changed, changed.size());
+            if (!loadMalformed(malformedPath, count))
+                throw std::runtime_error("Compressed level of version " + std::to_string(version) + " was loaded");
+        }
+
+        // Every header byte flipped, then random bytes of the payload replaced
+        std::mt19937 random(7);
+        size_t rejected = 0;
+        const size_t corruptions = sizeof(CompressedLevelHeader) + 512;
+        for (size_t i = 0; i < corruptions; i++)
+        {
+            std::vector<char> corrupted(bytes);
+            if (i < sizeof(CompressedLevelHeader))
+                corrupted[i] = static_cast<char>(corrupted[i] ^ 0xFF);
+            else
+                corrupted[random() % corrupted.size()] = static_cast<char>(random());
+            writeBytes(malformedPath, corrupted, corrupted.size());
+            rejected += loadMalformed(malformedPath, count) ? 1 : 0;
+        }
+        std::filesystem::remove(malformedPath);
+        std::cerr << "Compressed level with " << count << " obstacles: every truncation and unknown version rejected, " << rejected << " of " << corruptions
+                  << " corruptions rejected, the rest decoded to a level of the declared size" << std::endl;
+    }
+
+    // Fastest of the given number of loads in milliseconds
+    double measure(const std::function<LevelData()> &load, const unsigned repeats, const size_t expectedCount)
+    {
+        double best = 0.0;
+        for (unsigned i = 0; i < repeats; i++)
+        {
+            const auto begin = std::chrono::steady_clock::now();
+            const LevelData data = load();
+            const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            if (data.charges.size() != expectedCount)
+                throw std::runtime_error("Loaded " + std::to_string(data.charges.size()) + " obstacles instead of " + std::to_string(expectedCount));
+            if (i == 0 || elapsed < best)
+                best = elapsed;
+        }
+        return best;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const unsigned repeats = argc > 1 ? std::max(1, std::atoi(argv[1])) : 3;
+    const std::filesystem::path folder = std::filesystem::temp_directory_path() / "charge_level_benchmark";
+    std::filesystem::create_directories(folder);
+
+    std::cout << "level,obstacles,json bytes,binary bytes,compressed bytes,dom ms,streaming ms,binary ms,compressed ms" << std::endl;
+    try
+    {
+        for (const bool isPainted : {false, true})
+            for (const size_t count : {10000, 100000, 1000000})
+            {
+                const std::string jsonPath = (folder / "benchmark.json").string();
+                const std::string binaryPath = (folder / "benchmark.lvl").string();
+                const std::string compressedPath = (folder / "benchmark.clvl").string();
+                const LevelData level = isPainted ? makePaintedLevel(count) : makeLevel(count);
+                LevelManager::writeLevelFile(level, jsonPath, LevelFormat::Json);
+                LevelManager::writeLevelFile(level, binaryPath, LevelFormat::Binary);
+                LevelManager::writeLevelFile(level, compressedPath, LevelFormat::Compressed);
+
+                const double dom = measure([&jsonPath]() { return readJsonLevelDom(jsonPath); }, repeats, count);
+                const double streaming = measure([&jsonPath]() { return LevelManager::readLevelFile(jsonPath); }, repeats, count);
+                const double binary = measure([&binaryPath]() { return LevelManager::readLevelFile(binaryPath); }, repeats, count);
+                const double compressed = measure([&compressedPath]() { return LevelManager::readLevelFile(compressedPath); }, repeats, count);
+
+                // Positions of the compressed format are rounded to 1 / compressedPositionScale pixel
+                checkRoundTrip(level, LevelManager::readLevelFile(jsonPath), 0.0f, "JSON");
+                checkRoundTrip(level, LevelManager::readLevelFile(binaryPath), 0.0f, "Binary");
+                checkRoundTrip(level, LevelManager::readLevelFile(compressedPath), 0.5f / compressedPositionScale, "Compressed");
+                if (count == 10000)
+                    checkMalformedCompressed(compressedPath, count);
+                std::cout << (isPainted ? "painted" : "random") << ',' << count << ',' << std::filesystem::file_size(jsonPath) << ','
+                          << std::filesystem::file_size(binaryPath) << ',' << std::filesystem::file_size(compressedPath) << ','
+                          << dom << ',' << streaming << ',' << binary << ',' << compressed << std::endl;
+            }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        std::filesystem::remove_all(folder);
+        return 1;
+    }
+
+    std::filesystem::remove_all(folder);
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include <SFML\System.hpp>
+#include <iostream>
+#include <filesystem>
+#include <string>
+
+#include "levelManager.h"
+#include "levelData.h"
+#include "levelFormat.h"
+
+// Level file converter
+// Converts level files between the JSON, the binary and the compressed format (see levelFormat.h).
+// Only levelManager.cpp, chargeStore.cpp, mappedFile.cpp and compression.cpp have to be compiled with this file, linking sfml-system is enough.
+//
+// Usage: levelConverter <input file> <output file>
+//        levelConverter <input file> --import <json|lvl|clvl>
+//   The first form writes the output file and nothing else, the file isn't known to the game.
+//   The formats are chosen by the extensions, .lvl is binary, .clvl is compressed, everything else is JSON.
+//   The second form saves the level into levels/ through the level manager, in the format of the given extension, like saving
+//   it in the game does. The catalog entry of the level (name, obstacle count, bounding box, checksum) is added, or replaced if a
+//   level of the same name exists, and its files in the other formats and its journal are deleted.
+//   If the input is the file of a level in levels/, the edits in the journal of the level (levels/<name>.journal) are applied first.
+//   Run it while the game is closed, the game writes its own catalog when it exits.
+//
+// Exit code is 0 on success and 1 on errors.
+
+namespace
+{
+    // Format of a level file extension, with or without the dot
+    LevelFormat getFormat(std::string extension)
+    {
+        if (!extension.empty() && extension[0] == '.')
+            extension.erase(0, 1);
+        return extension == "lvl" ? LevelFormat::Binary : extension == "clvl" ? LevelFormat::Compressed : LevelFormat::Json;
+    }
+
+    // Name of a format for messages
+    const char *getFormatName(const LevelFormat format)
+    {
+        return format == LevelFormat::Binary ? "binary" : format == LevelFormat::Compressed ? "compressed" : "JSON";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const bool isImport = argc == 4 && std::string(argv[2]) == "--import";
+    if (argc != 3 && !isImport)
+    {
+        std::cerr << "Usage: levelConverter <input file> <output file>" << std::endl
+                  << "       levelConverter <input file> --import <json|lvl|clvl>" << std::endl;
+        return 1;
+    }
+
+    const std::string inputPath(argv[1]);
+    const LevelFormat outputFormat = getFormat(isImport ? argv[3] : std::filesystem::path(argv[2]).extension().string());
+    try
+    {
+        // The journal is only applied if it was started on this very file
+        LevelData data = LevelManager::readLevelFile(inputPath);
+        data = LevelManager::readSavedLevel(data.name, inputPath, nullptr);
+
+        if (isImport)
+        {
+            // A binary input in levels/ may be replaced by the import, it can't be while it is mapped on Windows
+            data.charges.detach();
+            LevelManager::getInstance()->saveLevel(data, outputFormat);
+            std::cerr << "Imported " << data.name << " with " << data.charges.size() << " obstacles as "
+                      << getFormatName(outputFormat) << " to " << LevelManager::getLevelPath(data.name, outputFormat) << std::endl;
+        }
+        else
+        {
+            LevelManager::writeLevelFile(data, argv[2], outputFormat);
+            std::cerr << "Converted " << data.name << " with " << data.charges.size() << " obstacles to " << getFormatName(outputFormat) << std::endl;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}